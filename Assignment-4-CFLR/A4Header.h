@@ -9,9 +9,34 @@
 #include <utility>
 
 #include "SVF-LLVM/SVFIRBuilder.h"
+#include "Util/CommandLine.h"
 
 using EdgeLabel = unsigned;
 
+/// Command-line options of cflr
+class CFLROptions
+{
+public:
+    /// Print the size of the graph and the time of the solver
+    static const SVF::Option<bool> PrintStat;
+    /// Solver computing the closure: worklist, matrix, parallel, demand or dyck
+    static const SVF::Option<std::string> Solver;
+    /// Threads of the parallel solver
+    static const SVF::Option<SVF::u32_t> Threads;
+    /// Run every solver and compare their results and times
+    static const SVF::Option<bool> Bench;
+    /// File of the grammar to solve instead of the points-to grammar
+    static const SVF::Option<std::string> Grammar;
+    /// Merge the nodes on VF cycles in the worklist solver
+    static const SVF::Option<bool> Collapse;
+    /// Nodes whose points-to sets are printed, computed on demand
+    static const SVF::Option<std::string> Query;
+    /// Facts a demand query may derive before the whole graph is solved instead
+    static const SVF::Option<SVF::u32_t> QueryBudget;
+    /// File of PAG edges inserted into and deleted from the solved graph
+    static const SVF::Option<std::string> Update;
+};
+
 enum EdgeLabelType
 {
     Addr, AddrBar,
@@ -59,7 +84,294 @@ template<>
 struct std::hash<CFLREdge>
 {
     size_t operator()(const CFLREdge &edge) const
-    { return ((uint64_t) edge.src << 32) | (uint64_t) edge.dst; }
+    { return (((uint64_t) edge.src << 32) | (uint64_t) edge.dst) ^ ((uint64_t) edge.label * 0x9E3779B97F4A7C15ull); }
+};
+
+
+/// Bits of the nodes and of the label in a packed edge
+const unsigned PackedNodeBits = 28;
+const unsigned PackedLabelBits = 8;
+
+/// An edge packed into one 64-bit key: the source, then the target, then the label
+inline uint64_t packEdge(unsigned src, unsigned dst, EdgeLabel label)
+{
+    // the all-ones key, with the largest label, is kept free for the empty slots of EdgeKeySet
+    assert(src >> PackedNodeBits == 0 && dst >> PackedNodeBits == 0 && label < (1u << PackedLabelBits) - 1
+           && "edge too large for a packed key");
+    return ((uint64_t) src << (PackedNodeBits + PackedLabelBits)) | ((uint64_t) dst << PackedLabelBits) | label;
+}
+
+inline CFLREdge unpackEdge(uint64_t key)
+{
+    const uint64_t nodeMask = (1ull << PackedNodeBits) - 1;
+    return CFLREdge(key >> (PackedNodeBits + PackedLabelBits), (key >> PackedLabelBits) & nodeMask,
+                    key & ((1u << PackedLabelBits) - 1));
+}
+
+
+/**
+ * A set of packed edges, stored in a flat table with linear probing and kept at most half full
+ */
+class EdgeKeySet
+{
+public:
+    EdgeKeySet() : slots(minCapacity, emptyKey), shift(64 - minLogCapacity)
+    {}
+
+    inline bool contains(uint64_t key) const
+    {
+        for (size_t i = home(key);; i = next(i))
+        {
+            if (slots[i] == key)
+                return true;
+            if (slots[i] == emptyKey)
+                return false;
+        }
+    }
+
+    /// Add a key, return true if it was not in the set
+    bool insert(uint64_t key);
+
+    /// Remove a key, closing the gap it leaves in its probe sequence
+    void erase(uint64_t key);
+
+    inline size_t size() const
+    { return count; }
+
+    void clear();
+
+private:
+    static const uint64_t emptyKey = ~0ull;
+    static const unsigned minLogCapacity = 4;
+    static const size_t minCapacity = 1u << minLogCapacity;
+
+    /// Fibonacci hashing: the top bits of the product
+    inline size_t home(uint64_t key) const
+    { return (key * 0x9E3779B97F4A7C15ull) >> shift; }
+
+    inline size_t next(size_t i) const
+    { return (i + 1) & (slots.size() - 1); }
+
+    void grow();
+
+    std::vector<uint64_t> slots;
+    unsigned shift;     ///< 64 - log2(capacity)
+    size_t count = 0;
+};
+
+
+/**
+ * FIFO worklist of edges, with the interface of WorkList<CFLREdge>: the pending edges are packed in a ring buffer
+ * that only reallocates when it is full, and a duplicate of a pending edge is dropped
+ */
+class EdgeWorkList
+{
+public:
+    EdgeWorkList() : ring(16)
+    {}
+
+    inline bool empty() const
+    { return count == 0; }
+
+    void clear();
+
+    inline bool push(const CFLREdge &edge)
+    {
+        uint64_t key = packEdge(edge.src, edge.dst, edge.label);
+        if (!pending.insert(key))
+            return false;
+        if (count == ring.size())
+            grow();
+        ring[(head + count) & (ring.size() - 1)] = key;
+        count++;
+        return true;
+    }
+
+    inline CFLREdge pop()
+    {
+        assert(!empty() && "work list is empty");
+        uint64_t key = ring[head];
+        head = (head + 1) & (ring.size() - 1);
+        count--;
+        pending.erase(key);
+        return unpackEdge(key);
+    }
+
+private:
+    /// Double the ring, unrolling it to start at 0
+    void grow();
+
+    std::vector<uint64_t> ring;     ///< a power-of-two number of slots
+    size_t head = 0;
+    size_t count = 0;
+    EdgeKeySet pending;
+};
+
+
+/// Number of the labels of the points-to grammar. A grammar file may add more after them.
+const EdgeLabel NumEdgeLabels = LVBar + 1;
+
+
+/**
+ * A grammar of the bidirected Dyck form
+ *     D ::= D D | O1 D C1 | ... | On D Cn | t1 | ... | tm | ε
+ * where the parentheses Oi and Ci and the plain labels tj are labels of PAG edges
+ */
+struct DyckForm
+{
+    EdgeLabel label;                                    ///< D
+    std::vector<std::pair<EdgeLabel, EdgeLabel>> parens;    ///< {Oi, Ci}
+    std::vector<EdgeLabel> plain;                       ///< tj
+};
+
+
+/**
+ * A context-free grammar over edge labels, in the normal form the solvers work on:
+ * X ::= ε, X ::= A and X ::= A B.
+ * The labels of the points-to grammar are always defined, with the ids of EdgeLabelType, since the graph is built
+ * with them; any other name gets the next free id. The productions are indexed by label, so a solver finds the
+ * productions an edge takes part in without any lookup.
+ */
+class CFLRGrammar
+{
+public:
+    using BinaryRule = std::tuple<EdgeLabel, EdgeLabel, EdgeLabel>;
+
+    CFLRGrammar();
+
+    /**
+     * Add the productions of a grammar file, one rule per line:
+     *     X ::= A B C | D | ε
+     * where "->" may replace "::=", "eps" or an empty alternative stands for ε, a line starting with "|" adds
+     * alternatives to the rule above it, and "#" starts a comment.
+     * @return false, after printing the error, if the file cannot be read or is malformed
+     */
+    bool load(const std::string &fileName);
+
+    /// Add X ::= rhs, normalised: a right-hand side of n > 2 labels is split into n - 1 binary productions
+    /// through fresh labels, shared by the productions with the same prefix
+    void addProduction(EdgeLabel lhs, const std::vector<EdgeLabel> &rhs);
+
+    /// Return the id of a label, defining it if it is new
+    EdgeLabel getOrAddLabel(const std::string &name);
+
+    /// Return whether a label is defined, setting `label` to its id if it is
+    bool findLabel(const std::string &name, EdgeLabel &label) const;
+
+    /// A label without productions, whose edges all come from the PAG
+    inline bool isTerminal(EdgeLabel label) const
+    { return !derivedLabels[label]; }
+
+    /// Return whether the grammar has the Dyck form, which is then filled in. The parentheses are recognised as
+    /// addProduction splits them: N ::= O D and D ::= N C, with N used nowhere else.
+    bool getDyckForm(DyckForm &form) const;
+
+    inline const std::string &getLabelName(EdgeLabel label) const
+    { return labelNames[label]; }
+
+    inline unsigned getNumLabels() const
+    { return labelNames.size(); }
+
+    /// X for X ::= ε
+    inline const std::vector<EdgeLabel> &getEpsilonLabels() const
+    { return epsilonLabels; }
+
+    /// {A, X} for X ::= A
+    inline const std::vector<std::pair<EdgeLabel, EdgeLabel>> &getUnaryRules() const
+    { return unaryRules; }
+
+    /// {A, B, X} for X ::= A B
+    inline const std::vector<BinaryRule> &getBinaryRules() const
+    { return binaryRules; }
+
+    /// X for X ::= A
+    inline const std::vector<EdgeLabel> &getUnaryByLabel(EdgeLabel A) const
+    { return unaryByLabel[A]; }
+
+    /// {B, X} for X ::= A B
+    inline const std::vector<std::pair<EdgeLabel, EdgeLabel>> &getBinaryByLeft(EdgeLabel A) const
+    { return byLeft[A]; }
+
+    /// {A, X} for X ::= A B
+    inline const std::vector<std::pair<EdgeLabel, EdgeLabel>> &getBinaryByRight(EdgeLabel B) const
+    { return byRight[B]; }
+
+private:
+    std::vector<std::string> labelNames;
+    std::unordered_map<std::string, EdgeLabel> labelIds;
+    std::map<std::pair<EdgeLabel, EdgeLabel>, EdgeLabel> splitLabels;  ///< fresh label of each split prefix
+    std::set<std::vector<EdgeLabel>> productions;                       ///< {X, rhs...} of the normal form
+
+    std::vector<bool> derivedLabels;    ///< the label has productions
+    std::vector<EdgeLabel> epsilonLabels;
+    std::vector<std::pair<EdgeLabel, EdgeLabel>> unaryRules;
+    std::vector<BinaryRule> binaryRules;
+    std::vector<std::vector<EdgeLabel>> unaryByLabel;
+    std::vector<std::vector<std::pair<EdgeLabel, EdgeLabel>>> byLeft;
+    std::vector<std::vector<std::pair<EdgeLabel, EdgeLabel>>> byRight;
+};
+
+
+/**
+ * A growable bitset over node ids, whose words span from the word of its smallest id to the word of its largest one
+ */
+class BitRow
+{
+public:
+    inline bool test(unsigned n) const
+    {
+        unsigned w = n >> 6;
+        if (w < base || w - base >= words.size())
+            return false;
+        return (words[w - base] >> (n & 63)) & 1;
+    }
+
+    /// Set a bit, return true if it was not set before
+    bool set(unsigned n);
+
+    inline void reset(unsigned n)
+    {
+        if (test(n))
+            words[(n >> 6) - base] &= ~((uint64_t) 1 << (n & 63));
+    }
+
+    inline void clear()
+    {
+        words.clear();
+        base = 0;
+    }
+
+    inline size_t getMemoryUsage() const
+    { return words.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> words;
+    unsigned base = 0;  ///< index of the first word
+};
+
+
+/**
+ * The edges of one label from (or to) one node
+ */
+struct CFLRAdj
+{
+    /// Rows up to this size are searched linearly, larger ones get a bitset
+    static const unsigned smallRowSize = 16;
+
+    EdgeLabel label;
+    std::vector<unsigned> nodes;    ///< adjacent nodes in insertion order
+    BitRow bits;                    ///< membership of the nodes once there are more than smallRowSize
+
+    explicit CFLRAdj(EdgeLabel lbl) : label(lbl)
+    {}
+
+    bool contains(unsigned n) const;
+
+    /// Append a node not in the row
+    void insert(unsigned n);
+
+    /// Remove a node of the row; the last node takes its place
+    void erase(unsigned n);
 };
 
 
@@ -69,8 +381,8 @@ struct std::hash<CFLREdge>
 class CFLRGraph
 {
 public:
-    /// We use a source -> label -> target map to represent the adjacency list of the predecessors/successors of nodes.
-    using DataMap = std::unordered_map<unsigned, std::unordered_map<EdgeLabel, std::unordered_set<unsigned>>>;
+    /// Adjacency of a node: one row per label it has edges of
+    using AdjRows = std::vector<CFLRAdj>;
 
     /// Construct a graph from a PAG
     explicit CFLRGraph(SVF::SVFIR *pag);
@@ -82,25 +394,184 @@ public:
      * @param label the label of the edge
      * @return true of the edge already exists, false otherwise
      */
-    bool hasEdge(unsigned src, unsigned dst, EdgeLabel label);
+    bool hasEdge(unsigned src, unsigned dst, EdgeLabel label) const;
 
     /**
      * Add an edge to the graph
      * @param src the source node of the edge
      * @param dst the target node of the edge
      * @param label the label of the edge
+     * @return true if the edge is new, false if it was already in the graph
+     */
+    bool addEdge(unsigned src, unsigned dst, EdgeLabel label);
+
+    /// Remove an edge, return true if it was in the graph. A node keeps rows only for the labels it has edges of.
+    bool removeEdge(unsigned src, unsigned dst, EdgeLabel label);
+
+    /// Remove all the edges of the labels flagged in `labels`
+    void removeLabels(const std::vector<bool> &labels);
+
+    /// Halves of addEdge for solvers that partition the nodes among threads: each row has a single writer, which
+    /// inserts the edge into the successor rows of its source (returning true if it is new) or into the predecessor
+    /// rows of its target. The nodes must exist, and the new edges are counted with countEdges.
+    bool insertSucc(unsigned src, unsigned dst, EdgeLabel label);
+    void insertPred(unsigned src, unsigned dst, EdgeLabel label);
+    inline void countEdges(size_t num)
+    { numEdges += num; }
+
+    /**
+     * Merge a node into another one: its edges are moved to the representative, with their endpoints renamed
+     * @param rep the node that stands for both from now on
+     * @param node the node merged, which is left without edges
+     * @param moved the edges that are new at the representative are appended to it
      */
-    void addEdge(unsigned src, unsigned dst, EdgeLabel label);
+    void mergeNode(unsigned rep, unsigned node, std::vector<CFLREdge> &moved);
+
+    /// Targets of the edges labelled `label` from `node`, in insertion order.
+    /// Adding an edge may invalidate the returned reference, so a caller adding edges should index the row again.
+    const std::vector<unsigned> &getSuccs(unsigned node, EdgeLabel label) const
+    { return getRow(succRows, node, label); }
+
+    /// Sources of the edges labelled `label` to `node`, in insertion order
+    const std::vector<unsigned> &getPreds(unsigned node, EdgeLabel label) const
+    { return getRow(predRows, node, label); }
 
-    DataMap &getSuccessorMap()
-    { return succMap; }
+    /// All the outgoing edges of a node, by label
+    const AdjRows &getSuccRows(unsigned node) const
+    { return node < succRows.size() ? succRows[node] : emptyRows; }
 
-    DataMap &getPredecessorMap()
-    { return predMap; }
+    const AdjRows &getPredRows(unsigned node) const
+    { return node < predRows.size() ? predRows[node] : emptyRows; }
+
+    /// One past the largest node id
+    inline unsigned getNodeNum() const
+    { return succRows.size(); }
+
+    inline size_t getEdgeNum() const
+    { return numEdges; }
+
+    /// Bytes held by the adjacency rows
+    size_t getMemoryUsage() const;
 
 protected:
-    DataMap predMap;   // holding predecessors
-    DataMap succMap;   // holding successors
+    static const std::vector<unsigned> &getRow(const std::vector<AdjRows> &rows, unsigned node, EdgeLabel label);
+    static CFLRAdj &getOrAddRow(std::vector<AdjRows> &rows, unsigned node, EdgeLabel label);
+    static void eraseFromRow(std::vector<AdjRows> &rows, unsigned node, EdgeLabel label, unsigned adj);
+
+    std::vector<AdjRows> predRows;  // holding predecessors, indexed by node id
+    std::vector<AdjRows> succRows;  // holding successors, indexed by node id
+    size_t numEdges = 0;
+    static const AdjRows emptyRows;
+};
+
+
+/**
+ * A boolean matrix over node ids, stored as bitset rows allocated on first use.
+ * Row i holds the bits (i, j) of the relation.
+ */
+class BitMatrix
+{
+public:
+    explicit BitMatrix(unsigned numNodes) : numWords((numNodes + 63) / 64), rows(numNodes)
+    {}
+
+    inline bool test(unsigned i, unsigned j) const
+    { return !rows[i].empty() && ((rows[i][j >> 6] >> (j & 63)) & 1); }
+
+    inline void set(unsigned i, unsigned j)
+    {
+        if (rows[i].empty())
+            rows[i].resize(numWords, 0);
+        rows[i][j >> 6] |= (uint64_t) 1 << (j & 63);
+    }
+
+    /// this |= other
+    void unionWith(const BitMatrix &other);
+
+    /// this &= ~other
+    void subtract(const BitMatrix &other);
+
+    /// this |= lhs . rhs, i.e., (i, k) for every (i, j) in lhs and (j, k) in rhs
+    void addProduct(const BitMatrix &lhs, const BitMatrix &rhs);
+
+    bool empty() const;
+
+    template<typename F>
+    void forEachInRow(unsigned i, F f) const
+    {
+        const std::vector<uint64_t> &row = rows[i];
+        for (unsigned w = 0; w < row.size(); w++)
+        {
+            for (uint64_t bits = row[w]; bits; bits &= bits - 1)
+                f(w * 64 + __builtin_ctzll(bits));
+        }
+    }
+
+private:
+    /// dst |= src over whole rows, a loop the compiler vectorises
+    static inline void orRow(uint64_t *__restrict dst, const uint64_t *__restrict src, unsigned numWords)
+    {
+        for (unsigned w = 0; w < numWords; w++)
+            dst[w] |= src[w];
+    }
+
+    unsigned numWords;
+    std::vector<std::vector<uint64_t>> rows;    ///< an empty vector is an empty row
+};
+
+
+/**
+ * Demand-driven CFL-reachability: the edges X(s, t) from one source s are computed by exploring from s only.
+ * Each (label, source) pair asked for gets an entry, filled from the graph, from ε and from the productions of
+ * the label, as in top-down evaluation with tabling: for X ::= A B, every target m of A(s, ·) asks for B(m, ·),
+ * whose targets are forwarded to X(s, ·). The entries are kept, so later queries reuse them.
+ */
+class CFLRDemand
+{
+public:
+    CFLRDemand(const CFLRGraph &graph, const CFLRGrammar &grammar);
+
+    /**
+     * Compute the edges labelled `label` from `src`
+     * @param budget the facts the query may derive, 0 for no limit
+     * @return false if the budget ran out, which leaves the entries incomplete and the object unusable
+     */
+    bool query(EdgeLabel label, unsigned src, size_t budget);
+
+    /// The targets of the edges labelled `label` from `src`, once queried
+    const std::vector<unsigned> &getTargets(EdgeLabel label, unsigned src) const;
+
+    /// Facts derived by all the queries so far
+    inline size_t getNumFacts() const
+    { return numFacts; }
+
+private:
+    struct Entry
+    {
+        std::vector<unsigned> targets;
+        BitRow seen;
+        unsigned processed = 0;     ///< targets[0, processed) have been passed to the continuations
+        std::vector<unsigned> forwards;                         ///< entries receiving every target
+        std::vector<std::pair<EdgeLabel, unsigned>> joins;      ///< {B, entry of X(s, ·)} for X ::= A B
+    };
+
+    /// Return the entry of label(src, ·), creating and seeding it on the first request
+    unsigned getEntry(EdgeLabel label, unsigned src);
+    void addFact(unsigned entry, unsigned target);
+    void addForward(unsigned entry, unsigned to);
+    void addJoin(unsigned entry, EdgeLabel right, unsigned to);
+
+    const CFLRGraph &graph;
+    const CFLRGrammar &grammar;
+    std::vector<std::vector<EdgeLabel>> unaryByLhs;                         ///< A for X ::= A
+    std::vector<std::vector<std::pair<EdgeLabel, EdgeLabel>>> binaryByLhs;  ///< {A, B} for X ::= A B
+    std::vector<bool> isEpsilon;
+
+    std::vector<Entry> entries;
+    std::unordered_map<uint64_t, unsigned> entryIds;    ///< (label, src) -> entry
+    std::unordered_set<uint64_t> forwardSet;            ///< (entry, to) of the forwards
+    std::deque<std::pair<unsigned, unsigned>> pending;  ///< targets not passed to the continuations yet
+    size_t numFacts = 0;
 };
 
 
@@ -156,22 +627,97 @@ protected:
  */
 class CFLR
 {
-    WorkList<CFLREdge> workList;
+    EdgeWorkList workList;
     CFLRGraph *graph;
+    CFLRGrammar grammar;
+    CFLRDemand *demand = nullptr;   ///< entries of the demand queries, kept until the graph is solved
+    bool solved = false;            ///< the graph holds the closure
+    bool updatable = false;         ///< the graph is solved without collapsing, see keepNodes()
+    bool fileGrammar = false;   ///< the grammar is loaded from a file instead of being the points-to grammar
+
+    /// Representative of each node once the VF cycles are collapsed; empty if they are not
+    std::vector<unsigned> nodeRep;
+    std::vector<bool> isObject;     ///< the node has Addr edges, so its PT edges are not the same as its cycle's
+    unsigned numCollapsed = 0;
+
+    /// Return the representative of a node
+    unsigned findRep(unsigned node);
+
+    /// Merge two nodes known to be on a VF cycle, pushing the edges new at the representative
+    void collapse(unsigned a, unsigned b);
+
+    /// Collapse the strongly connected components of the Copy edges before solving
+    void collapseCopyCycles();
+
+    /// Fill the productions of the points-to grammar
+    void initGrammar();
+
+    /// The worklist algorithm, over the productions enumerated by Rules
+    template<class Rules>
+    void solveWorklist(const Rules &rules);
+
+    /// Derive edges from the ones in the worklist until it is empty
+    template<class Rules>
+    void propagate(const Rules &rules);
+
+    /// propagate() with the productions of the grammar solved
+    void resumeWorklist();
+
+    /// The node has edges of the PAG, so the ε edges are at it
+    bool hasBaseEdges(unsigned node) const;
+
+    /// Return whether an edge derives in one step from the edges in the graph
+    bool isDerivable(const CFLREdge &edge) const;
 
 public:
     CFLR() : graph(nullptr)
-    {}
+    { initGrammar(); }
 
     ~CFLR()
-    { delete graph; }
+    {
+        delete demand;
+        delete graph;
+    }
+
+    /// Solve the grammar of a file instead of the points-to grammar
+    bool loadGrammar(const std::string &fileName);
 
     /// Build a graph from PAG
     void buildGraph(SVF::PAG *pag);
     /// The dynamic-programming CFL-reachability algorithm.
     void solve();
+    /// The same closure computed on boolean matrices, selected with -cflr-solver=matrix
+    void solveMatrix();
+    /// The same closure computed by several threads, selected with -cflr-solver=parallel
+    void solveParallel(unsigned numThreads);
+    /// The PT edges of every node computed as demand queries, selected with -cflr-solver=demand
+    void solveDemand();
+    /// Union-find Dyck-reachability for a bidirected Dyck grammar and graph, selected with -cflr-solver=dyck;
+    /// anything else is solved by the worklist solver
+    void solveDyck();
+    /// Solve with the solver named as in -cflr-solver
+    void solveWith(const std::string &solverName);
+    /// Return the points-to set of one node, exploring from it only unless the graph is solved or the query
+    /// exceeds -cflr-query-budget, which solves the graph
+    std::set<unsigned> queryPointsTo(unsigned node);
+
+    /// Add edges of the PAG to the solved graph and extend the closure from them only.
+    /// As in the graph built from the PAG, an edge is expected with its reverse, e.g., Copy(a, b) and CopyBar(b, a).
+    void insertEdges(const std::vector<CFLREdge> &edges);
+    /// Remove edges of the PAG from the solved graph and retract the edges that no longer derive
+    void deleteEdges(const std::vector<CFLREdge> &edges);
+    /// The graph is solved without merging any nodes, so that edges can be deleted later
+    inline void keepNodes()
+    { updatable = true; }
+
+    inline const CFLRGrammar &getGrammar() const
+    { return grammar; }
+    /// Return the PT edges, ordered
+    std::map<unsigned, std::set<unsigned>> getPointsTo() const;
     /// Dump results into a file
     void dumpResult();
+    /// Print the size of the graph and the solving time
+    void printStat(double solveTime) const;
 };
 
 #endif //ANSWERS_A4HEADER_H
@@ -4,6 +4,64 @@
  */
 
 #include "A4Header.h"
+#include <algorithm>
+#include <sstream>
+
+const SVF::Option<bool> CFLROptions::PrintStat(
+    "cflr-stat",
+    "Print the size of the CFL-reachability graph and the solving time",
+    false
+);
+
+const SVF::Option<std::string> CFLROptions::Solver(
+    "cflr-solver",
+    "Solver computing the CFL-reachability closure (worklist, matrix, parallel, demand, dyck)",
+    "worklist"
+);
+
+const SVF::Option<SVF::u32_t> CFLROptions::Threads(
+    "cflr-threads",
+    "Threads of the parallel solver (0 for one per core)",
+    0
+);
+
+const SVF::Option<bool> CFLROptions::Bench(
+    "cflr-bench",
+    "Run every solver on the graph, check that they compute the same points-to relation and compare their times",
+    false
+);
+
+const SVF::Option<std::string> CFLROptions::Grammar(
+    "cflr-grammar",
+    "File of the grammar to solve instead of the points-to grammar",
+    ""
+);
+
+const SVF::Option<bool> CFLROptions::Collapse(
+    "cflr-collapse",
+    "Merge the nodes on Copy/VF cycles of the points-to grammar in the worklist solver",
+    true
+);
+
+const SVF::Option<std::string> CFLROptions::Query(
+    "cflr-query",
+    "Comma-separated nodes whose points-to sets are printed, computed on demand instead of solving the graph",
+    ""
+);
+
+const SVF::Option<SVF::u32_t> CFLROptions::QueryBudget(
+    "cflr-query-budget",
+    "Facts a demand query may derive before the whole graph is solved instead (0 for no limit)",
+    1000000
+);
+
+const SVF::Option<std::string> CFLROptions::Update(
+    "cflr-update",
+    "File of PAG edges inserted into (\"+ Copy 3 4\") and deleted from (\"- Store 5 6\") the solved graph",
+    ""
+);
+
+const CFLRGraph::AdjRows CFLRGraph::emptyRows;
 
 CFLRGraph::CFLRGraph(SVF::SVFIR *pag)
 {
@@ -77,16 +135,702 @@ CFLRGraph::CFLRGraph(SVF::SVFIR *pag)
 }
 
 
-bool CFLRGraph::hasEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+CFLRGrammar::CFLRGrammar()
+{
+    static const char *const builtinNames[NumEdgeLabels] = {
+        "Addr", "AddrBar", "Copy", "CopyBar", "Store", "StoreBar", "Load", "LoadBar", "PT", "PTBar", "SV", "SVBar",
+        "PV", "PVBar", "VP", "VPBar", "VF", "VFBar", "VA", "VABar", "LV", "LVBar",
+    };
+    for (const char *name : builtinNames)
+        getOrAddLabel(name);
+}
+
+
+EdgeLabel CFLRGrammar::getOrAddLabel(const std::string &name)
+{
+    auto it = labelIds.find(name);
+    if (it != labelIds.end())
+        return it->second;
+    EdgeLabel label = labelNames.size();
+    labelIds[name] = label;
+    labelNames.push_back(name);
+    derivedLabels.push_back(false);
+    unaryByLabel.emplace_back();
+    byLeft.emplace_back();
+    byRight.emplace_back();
+    return label;
+}
+
+
+bool CFLRGrammar::findLabel(const std::string &name, EdgeLabel &label) const
+{
+    auto it = labelIds.find(name);
+    if (it == labelIds.end())
+        return false;
+    label = it->second;
+    return true;
+}
+
+
+void CFLRGrammar::addProduction(EdgeLabel lhs, const std::vector<EdgeLabel> &rhs)
+{
+    // X ::= A1 A2 ... An becomes N1 ::= A1 A2, N2 ::= N1 A3, ..., X ::= N(n-2) An
+    std::vector<EdgeLabel> normal = rhs;
+    while (normal.size() > 2)
+    {
+        std::pair<EdgeLabel, EdgeLabel> prefix(normal[0], normal[1]);
+        auto it = splitLabels.find(prefix);
+        if (it == splitLabels.end())
+        {
+            EdgeLabel fresh = getOrAddLabel(labelNames[prefix.first] + "." + labelNames[prefix.second]);
+            it = splitLabels.emplace(prefix, fresh).first;
+            addProduction(fresh, {prefix.first, prefix.second});
+        }
+        normal.erase(normal.begin());
+        normal[0] = it->second;
+    }
+    if (normal.size() == 1 && normal[0] == lhs)
+        return;     // X ::= X derives nothing new
+
+    std::vector<EdgeLabel> key = {lhs};
+    key.insert(key.end(), normal.begin(), normal.end());
+    if (!productions.insert(key).second)
+        return;
+    derivedLabels[lhs] = true;
+    if (normal.empty())
+        epsilonLabels.push_back(lhs);
+    else if (normal.size() == 1)
+    {
+        unaryRules.push_back({normal[0], lhs});
+        unaryByLabel[normal[0]].push_back(lhs);
+    }
+    else
+    {
+        binaryRules.push_back(BinaryRule(normal[0], normal[1], lhs));
+        byLeft[normal[0]].push_back({normal[1], lhs});
+        byRight[normal[1]].push_back({normal[0], lhs});
+    }
+}
+
+
+bool CFLRGrammar::getDyckForm(DyckForm &form) const
+{
+    if (epsilonLabels.size() != 1)
+        return false;
+    const EdgeLabel D = epsilonLabels[0];
+    if (productions.find({D, D, D}) == productions.end())
+        return false;
+
+    std::map<EdgeLabel, EdgeLabel> openOf, closeOf;     // of each N
+    for (const BinaryRule &r : binaryRules)
+    {
+        EdgeLabel A = std::get<0>(r), B = std::get<1>(r), X = std::get<2>(r);
+        if (X == D && A == D && B == D)
+            continue;
+        if (X == D && A != D && isTerminal(B) && !isTerminal(A))
+        {
+            if (!closeOf.emplace(A, B).second)
+                return false;
+        }
+        else if (X != D && isTerminal(A) && B == D)
+        {
+            if (!openOf.emplace(X, A).second)
+                return false;
+        }
+        else
+            return false;
+    }
+    if (openOf.size() != closeOf.size())
+        return false;
+
+    form.label = D;
+    form.parens.clear();
+    form.plain.clear();
+    std::set<EdgeLabel> used;
+    for (auto &nOpen : openOf)
+    {
+        auto close = closeOf.find(nOpen.first);
+        if (close == closeOf.end() || !used.insert(nOpen.second).second || !used.insert(close->second).second)
+            return false;
+        form.parens.push_back({nOpen.second, close->second});
+    }
+    for (auto &ur : unaryRules)
+    {
+        if (ur.second != D || !isTerminal(ur.first) || !used.insert(ur.first).second)
+            return false;
+        form.plain.push_back(ur.first);
+    }
+    return true;
+}
+
+
+bool CFLRGrammar::load(const std::string &fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+    {
+        SVF::SVFUtil::errs() << "error opening grammar " << fileName << "\n";
+        return false;
+    }
+
+    std::string line;
+    unsigned lineNo = 0;
+    bool hasLhs = false;
+    EdgeLabel lhs = 0;
+    while (std::getline(in, line))
+    {
+        lineNo++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        std::istringstream tokens(line);
+        std::vector<std::string> words;
+        for (std::string word; tokens >> word;)
+            words.push_back(word);
+        if (words.empty())
+            continue;
+
+        size_t pos = 0;
+        if (words[0] != "|")
+        {
+            if (words.size() < 2 || (words[1] != "::=" && words[1] != "->"))
+            {
+                SVF::SVFUtil::errs() << fileName << ":" << lineNo << ": expected \"X ::= ...\"\n";
+                return false;
+            }
+            lhs = getOrAddLabel(words[0]);
+            hasLhs = true;
+            pos = 2;
+        }
+        else if (!hasLhs)
+        {
+            SVF::SVFUtil::errs() << fileName << ":" << lineNo << ": alternatives without a rule\n";
+            return false;
+        }
+        else
+            pos = 1;
+
+        // the alternatives of the line, each ending at a "|" or at the end of the line
+        std::vector<EdgeLabel> rhs;
+        for (; pos <= words.size(); pos++)
+        {
+            if (pos == words.size() || words[pos] == "|")
+            {
+                addProduction(lhs, rhs);
+                rhs.clear();
+            }
+            else if (words[pos] == "::=" || words[pos] == "->")
+            {
+                SVF::SVFUtil::errs() << fileName << ":" << lineNo << ": one rule per line\n";
+                return false;
+            }
+            else if (words[pos] != "eps" && words[pos] != "ε")
+                rhs.push_back(getOrAddLabel(words[pos]));
+        }
+    }
+    return true;
+}
+
+
+bool EdgeKeySet::insert(uint64_t key)
+{
+    assert(key != emptyKey && "the empty key cannot be inserted");
+    if (2 * (count + 1) > slots.size())
+        grow();
+    size_t i = home(key);
+    for (; slots[i] != emptyKey; i = next(i))
+    {
+        if (slots[i] == key)
+            return false;
+    }
+    slots[i] = key;
+    count++;
+    return true;
+}
+
+
+void EdgeKeySet::erase(uint64_t key)
 {
-    return succMap[src][EdgeLabel].count(dst);
+    size_t i = home(key);
+    for (; slots[i] != key; i = next(i))
+    {
+        if (slots[i] == emptyKey)
+            return;
+    }
+    count--;
+    // move back the later keys of the cluster whose home is not between the hole and them
+    for (size_t j = next(i);; j = next(j))
+    {
+        if (slots[j] == emptyKey)
+            break;
+        size_t h = home(slots[j]);
+        bool reachable = (i <= j) ? (i < h && h <= j) : (i < h || h <= j);
+        if (!reachable)
+        {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i] = emptyKey;
+}
+
+
+void EdgeKeySet::clear()
+{
+    slots.assign(minCapacity, emptyKey);
+    shift = 64 - minLogCapacity;
+    count = 0;
+}
+
+
+void EdgeKeySet::grow()
+{
+    std::vector<uint64_t> old(slots.size() * 2, emptyKey);
+    old.swap(slots);
+    shift--;
+    for (uint64_t key : old)
+    {
+        if (key == emptyKey)
+            continue;
+        size_t i = home(key);
+        while (slots[i] != emptyKey)
+            i = next(i);
+        slots[i] = key;
+    }
+}
+
+
+void EdgeWorkList::clear()
+{
+    head = 0;
+    count = 0;
+    pending.clear();
+}
+
+
+void EdgeWorkList::grow()
+{
+    std::vector<uint64_t> larger(ring.size() * 2);
+    for (size_t i = 0; i < count; i++)
+        larger[i] = ring[(head + i) & (ring.size() - 1)];
+    ring.swap(larger);
+    head = 0;
+}
+
+
+bool BitRow::set(unsigned n)
+{
+    unsigned w = n >> 6;
+    if (words.empty())
+    {
+        base = w;
+        words.push_back(0);
+    }
+    else if (w < base)
+    {
+        words.insert(words.begin(), base - w, 0);
+        base = w;
+    }
+    else if (w - base >= words.size())
+        words.resize(w - base + 1, 0);
+    uint64_t mask = (uint64_t) 1 << (n & 63);
+    if (words[w - base] & mask)
+        return false;
+    words[w - base] |= mask;
+    return true;
+}
+
+
+bool CFLRAdj::contains(unsigned n) const
+{
+    if (nodes.size() <= smallRowSize)
+        return std::find(nodes.begin(), nodes.end(), n) != nodes.end();
+    return bits.test(n);
+}
+
+
+void CFLRAdj::insert(unsigned n)
+{
+    nodes.push_back(n);
+    if (nodes.size() == smallRowSize + 1)
+    {
+        for (unsigned m : nodes)
+            bits.set(m);
+    }
+    else if (nodes.size() > smallRowSize)
+        bits.set(n);
+}
+
+
+void CFLRAdj::erase(unsigned n)
+{
+    auto it = std::find(nodes.begin(), nodes.end(), n);
+    if (it == nodes.end())
+        return;
+    *it = nodes.back();
+    nodes.pop_back();
+    // a row back to the small size is searched linearly again, and its bits are refilled when it grows
+    if (nodes.size() == smallRowSize)
+        bits.clear();
+    else if (nodes.size() > smallRowSize)
+        bits.reset(n);
+}
+
+
+const std::vector<unsigned> &CFLRGraph::getRow(const std::vector<AdjRows> &rows, unsigned node, EdgeLabel label)
+{
+    static const std::vector<unsigned> emptyRow;
+    if (node >= rows.size())
+        return emptyRow;
+    for (const CFLRAdj &row : rows[node])
+    {
+        if (row.label == label)
+            return row.nodes;
+    }
+    return emptyRow;
+}
+
+
+CFLRAdj &CFLRGraph::getOrAddRow(std::vector<AdjRows> &rows, unsigned node, EdgeLabel label)
+{
+    AdjRows &nodeRows = rows[node];
+    for (CFLRAdj &row : nodeRows)
+    {
+        if (row.label == label)
+            return row;
+    }
+    nodeRows.emplace_back(label);
+    return nodeRows.back();
+}
+
+
+bool CFLRGraph::hasEdge(unsigned int src, unsigned int dst, EdgeLabel label) const
+{
+    if (src >= succRows.size())
+        return false;
+    for (const CFLRAdj &row : succRows[src])
+    {
+        if (row.label == label)
+            return row.contains(dst);
+    }
+    return false;
+}
+
+
+bool CFLRGraph::addEdge(unsigned int src, unsigned int dst, EdgeLabel label)
+{
+    unsigned maxId = std::max(src, dst);
+    if (maxId >= succRows.size())
+    {
+        succRows.resize(maxId + 1);
+        predRows.resize(maxId + 1);
+    }
+    CFLRAdj &succ = getOrAddRow(succRows, src, label);
+    if (succ.contains(dst))
+        return false;
+    succ.insert(dst);
+    getOrAddRow(predRows, dst, label).insert(src);
+    numEdges++;
+    return true;
 }
 
 
-void CFLRGraph::addEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+bool CFLRGraph::removeEdge(unsigned int src, unsigned int dst, EdgeLabel label)
 {
-    succMap[src][EdgeLabel].insert(dst);
-    predMap[dst][EdgeLabel].insert(src);
+    if (!hasEdge(src, dst, label))
+        return false;
+    eraseFromRow(succRows, src, label, dst);
+    eraseFromRow(predRows, dst, label, src);
+    numEdges--;
+    return true;
+}
+
+
+void CFLRGraph::eraseFromRow(std::vector<AdjRows> &rows, unsigned node, EdgeLabel label, unsigned adj)
+{
+    AdjRows &nodeRows = rows[node];
+    for (unsigned i = 0; i < nodeRows.size(); i++)
+    {
+        if (nodeRows[i].label != label)
+            continue;
+        nodeRows[i].erase(adj);
+        if (nodeRows[i].nodes.empty())
+        {
+            nodeRows[i] = std::move(nodeRows.back());
+            nodeRows.pop_back();
+        }
+        return;
+    }
+}
+
+
+void CFLRGraph::removeLabels(const std::vector<bool> &labels)
+{
+    for (std::vector<AdjRows> *rows : {&succRows, &predRows})
+    {
+        for (AdjRows &nodeRows : *rows)
+        {
+            nodeRows.erase(std::remove_if(nodeRows.begin(), nodeRows.end(),
+                                          [&](const CFLRAdj &row) { return labels[row.label]; }),
+                           nodeRows.end());
+        }
+    }
+    numEdges = 0;
+    for (const AdjRows &nodeRows : succRows)
+    {
+        for (const CFLRAdj &row : nodeRows)
+            numEdges += row.nodes.size();
+    }
+}
+
+
+bool CFLRGraph::insertSucc(unsigned int src, unsigned int dst, EdgeLabel label)
+{
+    CFLRAdj &succ = getOrAddRow(succRows, src, label);
+    if (succ.contains(dst))
+        return false;
+    succ.insert(dst);
+    return true;
+}
+
+
+void CFLRGraph::insertPred(unsigned int src, unsigned int dst, EdgeLabel label)
+{
+    getOrAddRow(predRows, dst, label).insert(src);
+}
+
+
+void CFLRGraph::mergeNode(unsigned rep, unsigned node, std::vector<CFLREdge> &moved)
+{
+    assert(rep != node && std::max(rep, node) < succRows.size() && "cannot merge these nodes");
+    AdjRows succs = std::move(succRows[node]);
+    AdjRows preds = std::move(predRows[node]);
+    succRows[node].clear();
+    predRows[node].clear();
+
+    // detach the edges from the other endpoints, a self-loop having both halves here
+    for (const CFLRAdj &row : succs)
+    {
+        for (unsigned dst : row.nodes)
+        {
+            if (dst != node)
+                getOrAddRow(predRows, dst, row.label).erase(node);
+            numEdges--;
+        }
+    }
+    for (const CFLRAdj &row : preds)
+    {
+        for (unsigned src : row.nodes)
+        {
+            if (src != node)
+            {
+                getOrAddRow(succRows, src, row.label).erase(node);
+                numEdges--;
+            }
+        }
+    }
+
+    for (const CFLRAdj &row : succs)
+    {
+        for (unsigned dst : row.nodes)
+        {
+            unsigned to = dst == node ? rep : dst;
+            if (addEdge(rep, to, row.label))
+                moved.push_back(CFLREdge(rep, to, row.label));
+        }
+    }
+    for (const CFLRAdj &row : preds)
+    {
+        for (unsigned src : row.nodes)
+        {
+            if (src != node && addEdge(src, rep, row.label))
+                moved.push_back(CFLREdge(src, rep, row.label));
+        }
+    }
+}
+
+
+size_t CFLRGraph::getMemoryUsage() const
+{
+    size_t bytes = (succRows.capacity() + predRows.capacity()) * sizeof(AdjRows);
+    for (const std::vector<AdjRows> *rows : {&succRows, &predRows})
+    {
+        for (const AdjRows &nodeRows : *rows)
+        {
+            bytes += nodeRows.capacity() * sizeof(CFLRAdj);
+            for (const CFLRAdj &row : nodeRows)
+                bytes += row.nodes.capacity() * sizeof(unsigned) + row.bits.getMemoryUsage();
+        }
+    }
+    return bytes;
+}
+
+
+CFLRDemand::CFLRDemand(const CFLRGraph &graph, const CFLRGrammar &grammar) :
+        graph(graph), grammar(grammar), unaryByLhs(grammar.getNumLabels()), binaryByLhs(grammar.getNumLabels()),
+        isEpsilon(grammar.getNumLabels(), false)
+{
+    for (auto &ur : grammar.getUnaryRules())
+        unaryByLhs[ur.second].push_back(ur.first);
+    for (auto &br : grammar.getBinaryRules())
+        binaryByLhs[std::get<2>(br)].push_back({std::get<0>(br), std::get<1>(br)});
+    for (EdgeLabel lbl : grammar.getEpsilonLabels())
+        isEpsilon[lbl] = true;
+}
+
+
+unsigned CFLRDemand::getEntry(EdgeLabel label, unsigned src)
+{
+    uint64_t key = ((uint64_t) label << 32) | src;
+    auto it = entryIds.find(key);
+    if (it != entryIds.end())
+        return it->second;
+    unsigned entry = entries.size();
+    entryIds[key] = entry;
+    entries.emplace_back();
+
+    // the edges in the graph, then ε as the solvers add it, to the nodes with edges
+    for (unsigned dst : graph.getSuccs(src, label))
+        addFact(entry, dst);
+    if (isEpsilon[label] && !graph.getSuccRows(src).empty())
+        addFact(entry, src);
+    for (EdgeLabel A : unaryByLhs[label])
+        addForward(getEntry(A, src), entry);
+    for (auto &rhs : binaryByLhs[label])
+        addJoin(getEntry(rhs.first, src), rhs.second, entry);
+    return entry;
+}
+
+
+void CFLRDemand::addFact(unsigned entry, unsigned target)
+{
+    if (!entries[entry].seen.set(target))
+        return;
+    entries[entry].targets.push_back(target);
+    pending.push_back({entry, target});
+    numFacts++;
+}
+
+
+void CFLRDemand::addForward(unsigned entry, unsigned to)
+{
+    if (!forwardSet.insert(((uint64_t) entry << 32) | to).second)
+        return;
+    entries[entry].forwards.push_back(to);
+    for (unsigned i = 0; i < entries[entry].processed; i++)
+        addFact(to, entries[entry].targets[i]);
+}
+
+
+void CFLRDemand::addJoin(unsigned entry, EdgeLabel right, unsigned to)
+{
+    entries[entry].joins.push_back({right, to});
+    // getEntry may add entries, so the targets are read by index
+    for (unsigned i = 0; i < entries[entry].processed; i++)
+        addForward(getEntry(right, entries[entry].targets[i]), to);
+}
+
+
+bool CFLRDemand::query(EdgeLabel label, unsigned src, size_t budget)
+{
+    size_t start = numFacts;
+    getEntry(label, src);
+    // the targets of an entry are passed on in the order they are found, so `processed` counts the popped ones
+    while (!pending.empty())
+    {
+        if (budget && numFacts - start > budget)
+            return false;
+        unsigned entry = pending.front().first, target = pending.front().second;
+        pending.pop_front();
+        entries[entry].processed++;
+        for (unsigned i = 0; i < entries[entry].forwards.size(); i++)
+            addFact(entries[entry].forwards[i], target);
+        for (unsigned i = 0; i < entries[entry].joins.size(); i++)
+        {
+            std::pair<EdgeLabel, unsigned> join = entries[entry].joins[i];
+            addForward(getEntry(join.first, target), join.second);
+        }
+    }
+    return true;
+}
+
+
+const std::vector<unsigned> &CFLRDemand::getTargets(EdgeLabel label, unsigned src) const
+{
+    static const std::vector<unsigned> noTargets;
+    auto it = entryIds.find(((uint64_t) label << 32) | src);
+    return it == entryIds.end() ? noTargets : entries[it->second].targets;
+}
+
+
+void BitMatrix::unionWith(const BitMatrix &other)
+{
+    for (unsigned i = 0; i < rows.size(); i++)
+    {
+        if (other.rows[i].empty())
+            continue;
+        if (rows[i].empty())
+            rows[i] = other.rows[i];
+        else
+            orRow(rows[i].data(), other.rows[i].data(), numWords);
+    }
+}
+
+
+void BitMatrix::subtract(const BitMatrix &other)
+{
+    for (unsigned i = 0; i < rows.size(); i++)
+    {
+        if (rows[i].empty() || other.rows[i].empty())
+            continue;
+        bool nonEmpty = false;
+        for (unsigned w = 0; w < numWords; w++)
+        {
+            rows[i][w] &= ~other.rows[i][w];
+            nonEmpty |= rows[i][w] != 0;
+        }
+        if (!nonEmpty)
+            rows[i].clear();
+    }
+}
+
+
+void BitMatrix::addProduct(const BitMatrix &lhs, const BitMatrix &rhs)
+{
+    for (unsigned i = 0; i < rows.size(); i++)
+    {
+        if (lhs.rows[i].empty())
+            continue;
+        lhs.forEachInRow(i, [&](unsigned j) {
+            if (rhs.rows[j].empty())
+                return;
+            if (rows[i].empty())
+                rows[i].resize(numWords, 0);
+            orRow(rows[i].data(), rhs.rows[j].data(), numWords);
+        });
+    }
+}
+
+
+bool BitMatrix::empty() const
+{
+    for (const std::vector<uint64_t> &row : rows)
+    {
+        if (!row.empty())
+            return false;
+    }
+    return true;
+}
+
+
+bool CFLR::loadGrammar(const std::string &fileName)
+{
+    CFLRGrammar loaded;
+    if (!loaded.load(fileName))
+        return false;
+    grammar = std::move(loaded);
+    fileGrammar = true;
+    return true;
 }
 
 
@@ -97,6 +841,48 @@ void CFLR::buildGraph(SVF::PAG *pag)
 }
 
 
+std::set<unsigned> CFLR::queryPointsTo(unsigned node)
+{
+    assert(graph && "CFLR graph not built yet.");
+    if (!solved)
+    {
+        if (!demand)
+            demand = new CFLRDemand(*graph, grammar);
+        if (demand->query(PT, node, CFLROptions::QueryBudget()))
+        {
+            const std::vector<unsigned> &dsts = demand->getTargets(PT, node);
+            return std::set<unsigned>(dsts.begin(), dsts.end());
+        }
+        // too costly on demand: the closure of the graph answers this query and the next ones
+        delete demand;
+        demand = nullptr;
+        solve();
+    }
+    unsigned rep = node;
+    while (!nodeRep.empty() && nodeRep[rep] != rep)
+        rep = nodeRep[rep];
+    const std::vector<unsigned> &dsts = graph->getSuccs(rep, PT);
+    return std::set<unsigned>(dsts.begin(), dsts.end());
+}
+
+
+std::map<unsigned, std::set<unsigned>> CFLR::getPointsTo() const
+{
+    std::map<unsigned, std::set<unsigned>> edgeSet;
+    for (unsigned src = 0; src < graph->getNodeNum(); src++)
+    {
+        // a node merged into its cycle shares the points-to set of the representative
+        unsigned rep = src;
+        while (!nodeRep.empty() && nodeRep[rep] != rep)
+            rep = nodeRep[rep];
+        const std::vector<unsigned> &dsts = graph->getSuccs(rep, PT);
+        if (!dsts.empty())
+            edgeSet[src].insert(dsts.begin(), dsts.end());
+    }
+    return edgeSet;
+}
+
+
 void CFLR::dumpResult()
 {
     std::string fname = SVF::PAG::getPAG()->getModuleIdentifier() + ".res.txt";
@@ -108,17 +894,7 @@ void CFLR::dumpResult()
     }
 
     // Collect S-edges
-    std::map<unsigned, std::set<unsigned >> edgeSet;  // ordered edge set
-    for (auto &nodeItr : graph->getSuccessorMap())
-    {
-        unsigned src = nodeItr.first;
-        for (auto &lblItr : nodeItr.second)
-        {
-            if (lblItr.first == PT)
-                for (auto dst : lblItr.second)
-                    edgeSet[src].insert(dst);
-        }
-    }
+    std::map<unsigned, std::set<unsigned >> edgeSet = getPointsTo();  // ordered edge set
 
     // Write S-edges
     for (auto &srcItr : edgeSet)
@@ -128,4 +904,16 @@ void CFLR::dumpResult()
             outFile << srcItr.first << '\t' << "points to" << '\t' << dst << std::endl;
         }
     }
-}
\ No newline at end of file
+}
+
+
+void CFLR::printStat(double solveTime) const
+{
+    std::cout << "\n*********CFLR Statistics*********\n";
+    std::cout << "Nodes:        " << graph->getNodeNum() << "\n";
+    std::cout << "Edges:        " << graph->getEdgeNum() << "\n";
+    std::cout << "Collapsed:    " << numCollapsed << " nodes\n";
+    std::cout << "Graph memory: " << graph->getMemoryUsage() / 1024 << " KB\n";
+    std::cout << "Solve time:   " << solveTime << " s\n";
+    std::cout << "*********************************\n";
+}
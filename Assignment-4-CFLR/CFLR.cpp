@@ -4,11 +4,85 @@
  */
 
 #include "A4Header.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
 
 using namespace SVF;
 using namespace llvm;
 using namespace std;
 
+/// Solve the graph of the PAG with every solver, timing them and checking they agree with the worklist solver
+static void benchmarkSolvers(PAG *pag)
+{
+    std::map<unsigned, std::set<unsigned>> expected;
+    for (const std::string solverName : {"worklist", "matrix", "parallel", "demand", "dyck"})
+    {
+        CFLR solver;
+        if (!CFLROptions::Grammar().empty() && !solver.loadGrammar(CFLROptions::Grammar()))
+            return;
+        solver.buildGraph(pag);
+        auto start = std::chrono::steady_clock::now();
+        solver.solveWith(solverName);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::map<unsigned, std::set<unsigned>> pointsTo = solver.getPointsTo();
+        if (solverName == "worklist")
+            expected = pointsTo;
+        std::cout << std::left << std::setw(10) << solverName << elapsed << " s"
+                  << (pointsTo == expected ? "" : "  MISMATCH with worklist") << "\n";
+    }
+}
+
+
+/// Apply a file of PAG edge changes to a solved graph, one "+ Label src dst" or "- Label src dst" per line.
+/// The reverse edge of each one, labelled Bar, is changed with it. The deletions go first.
+static bool applyUpdates(CFLR &solver, const std::string &fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+    {
+        SVFUtil::errs() << "error opening " << fileName << "\n";
+        return false;
+    }
+    const CFLRGrammar &grammar = solver.getGrammar();
+    std::vector<CFLREdge> inserted, deleted;
+    std::string op, name;
+    unsigned src, dst;
+    while (in >> op >> name >> src >> dst)
+    {
+        EdgeLabel label, reverse;
+        if ((op != "+" && op != "-") || !grammar.findLabel(name, label) || !grammar.isTerminal(label))
+        {
+            SVFUtil::errs() << fileName << ": bad update \"" << op << " " << name << "\"\n";
+            return false;
+        }
+        std::vector<CFLREdge> &edges = op == "+" ? inserted : deleted;
+        edges.push_back(CFLREdge(src, dst, label));
+        if (grammar.findLabel(name + "Bar", reverse))
+            edges.push_back(CFLREdge(dst, src, reverse));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    solver.deleteEdges(deleted);
+    solver.insertEdges(inserted);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (CFLROptions::PrintStat())
+        std::cout << "Updated " << deleted.size() << " deleted and " << inserted.size() << " inserted edges in "
+                  << elapsed << " s\n";
+    return true;
+}
+
+
 int main(int argc, char **argv)
 {
     auto moduleNameVec =
@@ -21,17 +95,285 @@ int main(int argc, char **argv)
     auto pag = builder.build();
     pag->dump();
 
+    if (CFLROptions::Bench())
+    {
+        benchmarkSolvers(pag);
+        LLVMModuleSet::releaseLLVMModuleSet();
+        return 0;
+    }
+
     CFLR solver;
+    if (!CFLROptions::Grammar().empty() && !solver.loadGrammar(CFLROptions::Grammar()))
+        return 1;
     solver.buildGraph(pag);
+    if (!CFLROptions::Query().empty())
+    {
+        std::stringstream nodes(CFLROptions::Query());
+        for (std::string node; std::getline(nodes, node, ',');)
+        {
+            char *end;
+            errno = 0;
+            unsigned long id = std::strtoul(node.c_str(), &end, 10);
+            if (node.empty() || *end != '\0' || errno == ERANGE || id >= pag->getTotalNodeNum())
+            {
+                SVFUtil::errs() << "-cflr-query: bad node id \"" << node << "\"\n";
+                return 1;
+            }
+            std::cout << node << " points to {";
+            const char *sep = "";
+            for (unsigned obj : solver.queryPointsTo(id))
+            {
+                std::cout << sep << obj;
+                sep = ", ";
+            }
+            std::cout << "}\n";
+        }
+        LLVMModuleSet::releaseLLVMModuleSet();
+        return 0;
+    }
     // TODO: complete this method
-    solver.solve();
+    const std::string &updateFile = CFLROptions::Update();
+    if (!updateFile.empty())
+    {
+        if (CFLROptions::Solver() == "demand")
+        {
+            SVFUtil::errs() << "-cflr-update needs the closure of the whole graph, not -cflr-solver=demand\n";
+            return 1;
+        }
+        solver.keepNodes();
+    }
+    auto start = std::chrono::steady_clock::now();
+    solver.solveWith(CFLROptions::Solver());
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!updateFile.empty() && !applyUpdates(solver, updateFile))
+        return 1;
     solver.dumpResult();
+    if (CFLROptions::PrintStat())
+        solver.printStat(elapsed);
 
     LLVMModuleSet::releaseLLVMModuleSet();
     return 0;
 }
 
 
+void CFLR::solveWith(const std::string &solverName)
+{
+    if (solverName == "matrix")
+        solveMatrix();
+    else if (solverName == "demand")
+        solveDemand();
+    else if (solverName == "dyck")
+        solveDyck();
+    else if (solverName == "parallel")
+        solveParallel(CFLROptions::Threads() ? CFLROptions::Threads() : std::thread::hardware_concurrency());
+    else
+    {
+        assert(solverName == "worklist" && "unknown CFLR solver");
+        solve();
+    }
+}
+
+
+/// The points-to grammar, as compile-time tables
+struct PTUnaryRule
+{
+    EdgeLabel rhs, lhs;     // lhs ::= rhs
+};
+
+struct PTBinaryRule
+{
+    EdgeLabel left, right, lhs;     // lhs ::= left right
+};
+
+static constexpr EdgeLabel ptEpsilonLabels[] = {VF, VFBar, VA};
+
+static constexpr PTUnaryRule ptUnaryRules[] = {
+    {Copy, VF},         // Copy → VF
+    {CopyBar, VFBar},   // CopyBar → VFBar
+};
+
+static constexpr PTBinaryRule ptBinaryRules[] = {
+    // PT and PTBar
+    {VFBar, AddrBar, PT},
+    {Addr, VF, PTBar},
+
+    // VF rules
+    {VF, VF, VF},
+    {SV, Load, VF},
+    {PV, Load, VF},
+    {Store, VP, VF},
+
+    // VFBar rules
+    {VFBar, VFBar, VFBar},
+    {LoadBar, SVBar, VFBar},
+    {LoadBar, VP, VFBar},
+    {PV, StoreBar, VFBar},
+
+    // VA rules
+    {LV, Load, VA},
+    {VFBar, VA, VA},
+    {VA, VF, VA},
+
+    // SV rules
+    {Store, VA, SV},
+
+    // SVBar rules
+    {VA, StoreBar, SVBar},
+
+    // PV rules
+    {PTBar, VA, PV},
+
+    // VP rules
+    {VA, PT, VP},
+
+    // LV rules
+    {LoadBar, VA, LV},
+};
+
+/// The other operand and the result of a binary rule
+struct PTJoin
+{
+    EdgeLabel other, lhs;
+};
+
+/// Number of the binary rules with operand L on the left (Right = false) or on the right
+static constexpr unsigned countPTJoins(EdgeLabel L, bool Right)
+{
+    unsigned n = 0;
+    for (const PTBinaryRule &r : ptBinaryRules)
+        n += (Right ? r.right : r.left) == L;
+    return n;
+}
+
+/// The binary rules of label L, computed at compile time
+template<EdgeLabel L, bool Right>
+struct PTJoinTable
+{
+    static constexpr std::array<PTJoin, countPTJoins(L, Right)> build()
+    {
+        std::array<PTJoin, countPTJoins(L, Right)> joins{};
+        unsigned n = 0;
+        for (const PTBinaryRule &r : ptBinaryRules)
+        {
+            if ((Right ? r.right : r.left) == L)
+                joins[n++] = {Right ? r.left : r.right, r.lhs};
+        }
+        return joins;
+    }
+
+    static constexpr std::array<PTJoin, countPTJoins(L, Right)> joins = build();
+};
+
+template<EdgeLabel L>
+struct PTUnaryTable
+{
+    static constexpr unsigned count()
+    {
+        unsigned n = 0;
+        for (const PTUnaryRule &r : ptUnaryRules)
+            n += r.rhs == L;
+        return n;
+    }
+
+    static constexpr std::array<EdgeLabel, count()> build()
+    {
+        std::array<EdgeLabel, count()> lhs{};
+        unsigned n = 0;
+        for (const PTUnaryRule &r : ptUnaryRules)
+        {
+            if (r.rhs == L)
+                lhs[n++] = r.lhs;
+        }
+        return lhs;
+    }
+
+    static constexpr std::array<EdgeLabel, count()> lhs = build();
+};
+
+/// Call f with L as a compile-time constant; the comparisons fold into a switch on L
+template<typename F, EdgeLabel... Ls>
+static inline void dispatchPTLabel(EdgeLabel L, F &&f, std::integer_sequence<EdgeLabel, Ls...>)
+{
+    (void) ((L == Ls && (f(std::integral_constant<EdgeLabel, Ls>()), true)) || ...);
+}
+
+/// The productions of the points-to grammar, dispatched on the label at compile time
+struct PointsToRules
+{
+    template<typename F>
+    static inline void dispatch(EdgeLabel L, F &&f)
+    { dispatchPTLabel(L, f, std::make_integer_sequence<EdgeLabel, NumEdgeLabels>()); }
+
+    /// f(X) for X ::= L
+    template<typename F>
+    inline void forEachUnary(EdgeLabel L, F &&f) const
+    {
+        dispatch(L, [&](auto lbl) {
+            for (EdgeLabel X : PTUnaryTable<decltype(lbl)::value>::lhs)
+                f(X);
+        });
+    }
+
+    /// f(B, X) for X ::= L B
+    template<typename F>
+    inline void forEachByLeft(EdgeLabel L, F &&f) const
+    {
+        dispatch(L, [&](auto lbl) {
+            for (const PTJoin &j : PTJoinTable<decltype(lbl)::value, false>::joins)
+                f(j.other, j.lhs);
+        });
+    }
+
+    /// f(A, X) for X ::= A L
+    template<typename F>
+    inline void forEachByRight(EdgeLabel L, F &&f) const
+    {
+        dispatch(L, [&](auto lbl) {
+            for (const PTJoin &j : PTJoinTable<decltype(lbl)::value, true>::joins)
+                f(j.other, j.lhs);
+        });
+    }
+};
+
+/// The productions of a grammar loaded at run time, with the interface of PointsToRules
+struct GrammarRules
+{
+    const CFLRGrammar &grammar;
+
+    template<typename F>
+    inline void forEachUnary(EdgeLabel L, F &&f) const
+    {
+        for (EdgeLabel X : grammar.getUnaryByLabel(L))
+            f(X);
+    }
+
+    template<typename F>
+    inline void forEachByLeft(EdgeLabel L, F &&f) const
+    {
+        for (auto &pairBC : grammar.getBinaryByLeft(L))
+            f(pairBC.first, pairBC.second);
+    }
+
+    template<typename F>
+    inline void forEachByRight(EdgeLabel L, F &&f) const
+    {
+        for (auto &pairAC : grammar.getBinaryByRight(L))
+            f(pairAC.first, pairAC.second);
+    }
+};
+
+
+void CFLR::initGrammar()
+{
+    for (const PTUnaryRule &r : ptUnaryRules)
+        grammar.addProduction(r.lhs, {r.rhs});
+    for (const PTBinaryRule &r : ptBinaryRules)
+        grammar.addProduction(r.lhs, {r.left, r.right});
+    for (EdgeLabel lbl : ptEpsilonLabels)
+        grammar.addProduction(lbl, {});
+}
+
+
 void CFLR::solve()
 {
     // TODO: complete this function. The implementations of graph and worklist are provided.
@@ -43,162 +385,738 @@ void CFLR::solve()
     // Step 1: Initialize worklist with all existing edges
     // Add all existing edges in the graph to worklist
     assert(graph && "CFLR graph not built yet.");
+    // the built-in grammar is compiled into the loop, a grammar file is read from its tables
+    if (fileGrammar)
+        solveWorklist(GrammarRules{grammar});
+    else
+    {
+        // the nodes on a VF cycle of the points-to grammar have the same points-to sets, see collapse()
+        if (CFLROptions::Collapse() && !updatable)
+            collapseCopyCycles();
+        solveWorklist(PointsToRules());
+    }
+    solved = true;
+}
 
-    // ========== Unary rules ==========
-    std::vector<std::pair<EdgeLabel, EdgeLabel>> unaryRules = {
-        {Copy, VF},   // Copy → VF
-        {CopyBar, VFBar},   // CopyBar → VFBar
-    };
 
-    // ========== Binary rules ==========
-    using Rule = std::tuple<EdgeLabel, EdgeLabel, EdgeLabel>;
-    std::vector<Rule> binaryRules = {
-        // PT and PTBar
-        {VFBar, AddrBar, PT},
-        {Addr, VF, PTBar},
-
-        // VF rules
-        {VF, VF, VF},
-        {SV, Load, VF},
-        {PV, Load, VF},
-        {Store, VP, VF},
-
-        // VFBar rules
-        {VFBar, VFBar, VFBar},
-        {LoadBar, SVBar, VFBar},
-        {LoadBar, VP, VFBar},
-        {PV, StoreBar, VFBar},
-
-        // VA rules
-        {LV, Load, VA},
-        {VFBar, VA, VA},
-        {VA, VF, VA},
-
-        // SV rules
-        {Store, VA, SV},
-
-        // SVBar rules
-        {VA, StoreBar, SVBar},
-
-        // PV rules
-        {PTBar, VA, PV},
-
-        // VP rules
-        {VA, PT, VP},
-        // LV rules
-        {LoadBar, VA, LV},
+/// Every node is queried on its own, sharing the entries of the previous queries, and its PT edges are added to
+/// the graph. A query over the budget solves the whole graph, which then has them all.
+void CFLR::solveDemand()
+{
+    assert(graph && "CFLR graph not built yet.");
+    std::vector<std::pair<unsigned, std::set<unsigned>>> pointsTo;
+    for (unsigned node = 0; node < graph->getNodeNum() && !solved; node++)
+    {
+        if (!graph->getSuccRows(node).empty())
+            pointsTo.push_back({node, queryPointsTo(node)});
+    }
+    if (solved)
+        return;
+    for (auto &nodePts : pointsTo)
+    {
+        for (unsigned obj : nodePts.second)
+            graph->addEdge(nodePts.first, obj, PT);
+    }
+    solved = true;
+    delete demand;
+    demand = nullptr;
+}
+
+
+unsigned CFLR::findRep(unsigned node)
+{
+    unsigned rep = node;
+    while (nodeRep[rep] != rep)
+        rep = nodeRep[rep];
+    while (nodeRep[node] != rep)
+    {
+        unsigned next = nodeRep[node];
+        nodeRep[node] = rep;
+        node = next;
+    }
+    return rep;
+}
+
+
+/// With VF(a, b) and VF(b, a), every production of the points-to grammar that joins an edge ending at a with one
+/// starting at b also holds through the VF path between them, since VF, VFBar and VA absorb such paths on either
+/// side (e.g., X ::= VA VF and VA ::= VFBar VA). So a and b can be merged without changing PT, except for the
+/// objects: two objects on a cycle still point to different places, so they are never merged.
+void CFLR::collapse(unsigned a, unsigned b)
+{
+    a = findRep(a);
+    b = findRep(b);
+    if (a == b || isObject[a] || isObject[b])
+        return;
+    nodeRep[b] = a;
+    numCollapsed++;
+    std::vector<CFLREdge> moved;
+    graph->mergeNode(a, b, moved);
+    for (const CFLREdge &edge : moved)
+        workList.push(edge);
+}
+
+
+/// Tarjan's algorithm over the Copy edges between pointers, without recursion
+void CFLR::collapseCopyCycles()
+{
+    const unsigned numNodes = graph->getNodeNum();
+    const unsigned unvisited = ~0u;
+    nodeRep.resize(numNodes);
+    isObject.assign(numNodes, false);
+    for (unsigned node = 0; node < numNodes; node++)
+    {
+        nodeRep[node] = node;
+        isObject[node] = !graph->getSuccs(node, Addr).empty();
+    }
+
+    std::vector<unsigned> index(numNodes, unvisited), low(numNodes);
+    std::vector<bool> onStack(numNodes, false);
+    std::vector<unsigned> sccStack;
+    std::vector<std::pair<unsigned, size_t>> dfsStack;     // node and position of its next Copy successor
+    std::vector<std::vector<unsigned>> cycles;
+    unsigned counter = 0;
+    auto visit = [&](unsigned node) {
+        index[node] = low[node] = counter++;
+        sccStack.push_back(node);
+        onStack[node] = true;
+        dfsStack.push_back({node, 0});
     };
 
-    // ===== Initialize ε-edges =====
-    // 文法中 ε 的非终结符：VF, VFBar, VA
-    std::vector<EdgeLabel> epsilonLabels = {VF, VFBar, VA};
-    for (auto &nodePair : graph->getSuccessorMap())
+    for (unsigned root = 0; root < numNodes; root++)
     {
-        unsigned node = nodePair.first;
-        for (EdgeLabel lbl : epsilonLabels)
+        if (isObject[root] || index[root] != unvisited || graph->getSuccs(root, Copy).empty())
+            continue;
+        visit(root);
+        while (!dfsStack.empty())
         {
-            if (!graph->hasEdge(node, node, lbl))
+            unsigned node = dfsStack.back().first;
+            const std::vector<unsigned> &succs = graph->getSuccs(node, Copy);
+            if (dfsStack.back().second < succs.size())
             {
-                graph->addEdge(node, node, lbl);
-                workList.push(CFLREdge(node, node, lbl));
+                unsigned succ = succs[dfsStack.back().second++];
+                if (isObject[succ])
+                    continue;
+                if (index[succ] == unvisited)
+                    visit(succ);
+                else if (onStack[succ])
+                    low[node] = std::min(low[node], index[succ]);
+                continue;
             }
+
+            dfsStack.pop_back();
+            if (!dfsStack.empty())
+                low[dfsStack.back().first] = std::min(low[dfsStack.back().first], low[node]);
+            if (low[node] != index[node])
+                continue;
+            std::vector<unsigned> scc;
+            unsigned member;
+            do
+            {
+                member = sccStack.back();
+                sccStack.pop_back();
+                onStack[member] = false;
+                scc.push_back(member);
+            } while (member != node);
+            if (scc.size() > 1)
+                cycles.push_back(std::move(scc));
         }
     }
 
+    // merged once the search is over, since merging reorders the rows it walks
+    for (const std::vector<unsigned> &scc : cycles)
+    {
+        for (unsigned member : scc)
+            collapse(scc.back(), member);
+    }
+}
+
 
-    // Build index maps for efficiency
-    std::unordered_map<EdgeLabel, std::vector<std::pair<EdgeLabel, EdgeLabel>>> byLeft, byRight;
-    for (auto &r : binaryRules)
+template<class Rules>
+void CFLR::solveWorklist(const Rules &rules)
+{
+    // ===== Initialize ε-edges =====
+    for (unsigned node = 0; node < graph->getNodeNum(); node++)
     {
-        EdgeLabel A = std::get<0>(r), B = std::get<1>(r), C = std::get<2>(r);
-        byLeft[A].push_back({B, C});
-        byRight[B].push_back({A, C});
+        if (graph->getSuccRows(node).empty())
+            continue;
+        for (EdgeLabel lbl : grammar.getEpsilonLabels())
+        {
+            if (graph->addEdge(node, node, lbl))
+                workList.push(CFLREdge(node, node, lbl));
+        }
     }
 
     // ===== Initialize the worklist with all existing edges =====
-    for (auto &srcEntry : graph->getSuccessorMap())
+    for (unsigned src = 0; src < graph->getNodeNum(); src++)
     {
-        unsigned src = srcEntry.first;
-        for (auto &lblEntry : srcEntry.second)
+        for (const CFLRAdj &row : graph->getSuccRows(src))
         {
-            EdgeLabel lbl = lblEntry.first;
-            for (unsigned dst : lblEntry.second)
-                workList.push(CFLREdge(src, dst, lbl));
+            for (unsigned dst : row.nodes)
+                workList.push(CFLREdge(src, dst, row.label));
         }
     }
 
+    propagate(rules);
+}
+
+
+template<class Rules>
+void CFLR::propagate(const Rules &rules)
+{
+    // cycles of VF closed by the edges of the current step, merged after it
+    const bool collapsing = !nodeRep.empty();
+    std::vector<std::pair<unsigned, unsigned>> cycles;
+    auto derive = [&](unsigned src, unsigned dst, EdgeLabel lbl) {
+        if (!graph->addEdge(src, dst, lbl))
+            return;
+        workList.push(CFLREdge(src, dst, lbl));
+        if (collapsing && lbl == VF && src != dst && graph->hasEdge(dst, src, VF))
+            cycles.push_back({src, dst});
+    };
+
     // ===== Dynamic programming iteration =====
     while (!workList.empty())
     {
         CFLREdge e = workList.pop();
         unsigned u = e.src, v = e.dst;
         EdgeLabel L = e.label;
+        // an edge of a merged node has been moved to its representative
+        if (collapsing && (nodeRep[u] != u || nodeRep[v] != v))
+            continue;
 
         // ---- Unary rules ----
-        for (auto &ur : unaryRules)
+        rules.forEachUnary(L, [&](EdgeLabel Lp) { derive(u, v, Lp); });
+
+        // ---- Binary join: (L ; B) -> C ----
+        rules.forEachByLeft(L, [&](EdgeLabel B, EdgeLabel C) {
+            // the edges added below are joined when they are popped, and may move the row
+            size_t n = graph->getSuccs(v, B).size();
+            for (size_t i = 0; i < n; i++)
+                derive(u, graph->getSuccs(v, B)[i], C);
+        });
+
+        // ---- Binary join: (A ; L) -> C ----
+        rules.forEachByRight(L, [&](EdgeLabel A, EdgeLabel C) {
+            size_t n = graph->getPreds(u, A).size();
+            for (size_t i = 0; i < n; i++)
+                derive(graph->getPreds(u, A)[i], v, C);
+        });
+
+        for (auto &cycle : cycles)
+            collapse(cycle.first, cycle.second);
+        cycles.clear();
+    }
+}
+
+
+void CFLR::resumeWorklist()
+{
+    if (fileGrammar)
+        propagate(GrammarRules{grammar});
+    else
+        propagate(PointsToRules());
+}
+
+
+bool CFLR::hasBaseEdges(unsigned node) const
+{
+    for (const CFLRAdj &row : graph->getSuccRows(node))
+    {
+        if (grammar.isTerminal(row.label) && !row.nodes.empty())
+            return true;
+    }
+    return false;
+}
+
+
+bool CFLR::isDerivable(const CFLREdge &edge) const
+{
+    unsigned u = edge.src, v = edge.dst;
+    if (grammar.isTerminal(edge.label))
+        return false;
+    if (u == v && hasBaseEdges(u))
+    {
+        const std::vector<EdgeLabel> &eps = grammar.getEpsilonLabels();
+        if (std::find(eps.begin(), eps.end(), edge.label) != eps.end())
+            return true;
+    }
+    for (auto &ur : grammar.getUnaryRules())
+    {
+        if (ur.second == edge.label && graph->hasEdge(u, v, ur.first))
+            return true;
+    }
+    for (auto &br : grammar.getBinaryRules())
+    {
+        if (std::get<2>(br) != edge.label)
+            continue;
+        for (unsigned m : graph->getSuccs(u, std::get<0>(br)))
         {
-            if (ur.first == L)
+            if (graph->hasEdge(m, v, std::get<1>(br)))
+                return true;
+        }
+    }
+    return false;
+}
+
+
+void CFLR::insertEdges(const std::vector<CFLREdge> &edges)
+{
+    assert(graph && solved && nodeRep.empty() && "edges are inserted into a closure solved without collapsing");
+    for (const CFLREdge &edge : edges)
+    {
+        // a node gets its ε edges with its first outgoing edge, as in solve()
+        if (!hasBaseEdges(edge.src))
+        {
+            for (EdgeLabel lbl : grammar.getEpsilonLabels())
             {
-                EdgeLabel Lp = ur.second;
-                if (!graph->hasEdge(u, v, Lp))
-                {
-                    graph->addEdge(u, v, Lp);
-                    workList.push(CFLREdge(u, v, Lp));
-                }
+                if (graph->addEdge(edge.src, edge.src, lbl))
+                    workList.push(CFLREdge(edge.src, edge.src, lbl));
             }
         }
+        if (graph->addEdge(edge.src, edge.dst, edge.label))
+            workList.push(edge);
+    }
+    resumeWorklist();
+}
 
-        auto &succMap = graph->getSuccessorMap();
-        auto &predMap = graph->getPredecessorMap();
 
-        // ---- Binary join: (L ; B) -> C ----
-        if (byLeft.count(L))
+/// Delete and re-derive (DRed):
+///  1. over-delete: the deleted edges are removed, with every edge having a derivation step that uses a removed
+///     edge, and the ε edges of the nodes left without outgoing edges of the PAG;
+///  2. re-derive: an over-deleted edge that still derives in one step from the remaining edges is added back;
+///  3. the edges added back are propagated as insertions.
+/// The work is bounded by the edges whose derivations go through the deleted ones, not by the graph. When these
+/// are most of the graph, as for an edge on the main VF cycle, the closure is computed again instead.
+void CFLR::deleteEdges(const std::vector<CFLREdge> &edges)
+{
+    assert(graph && solved && nodeRep.empty() && "edges are deleted from a closure solved without collapsing");
+    EdgeWorkList toDelete;
+    std::vector<CFLREdge> overDeleted;
+    const size_t maxOverDeleted = graph->getEdgeNum() / 2;
+    auto overDelete = [&]() {
+        while (!toDelete.empty())
+        {
+            if (overDeleted.size() > maxOverDeleted)
+                return false;
+            CFLREdge e = toDelete.pop();
+            if (!graph->hasEdge(e.src, e.dst, e.label))
+                continue;
+            auto consequence = [&](unsigned src, unsigned dst, EdgeLabel lbl) {
+                if (graph->hasEdge(src, dst, lbl))
+                    toDelete.push(CFLREdge(src, dst, lbl));
+            };
+            for (EdgeLabel X : grammar.getUnaryByLabel(e.label))
+                consequence(e.src, e.dst, X);
+            for (auto &pairBX : grammar.getBinaryByLeft(e.label))
+            {
+                for (unsigned w : graph->getSuccs(e.dst, pairBX.first))
+                    consequence(e.src, w, pairBX.second);
+            }
+            for (auto &pairAX : grammar.getBinaryByRight(e.label))
+            {
+                for (unsigned p : graph->getPreds(e.src, pairAX.first))
+                    consequence(p, e.dst, pairAX.second);
+            }
+            graph->removeEdge(e.src, e.dst, e.label);
+            if (!grammar.isTerminal(e.label))
+                overDeleted.push_back(e);
+        }
+        return true;
+    };
+
+    for (const CFLREdge &edge : edges)
+        toDelete.push(edge);
+    bool bounded = overDelete();
+    for (const CFLREdge &edge : edges)
+    {
+        if (hasBaseEdges(edge.src))
+            continue;
+        for (EdgeLabel lbl : grammar.getEpsilonLabels())
+            toDelete.push(CFLREdge(edge.src, edge.src, lbl));
+    }
+    if (!bounded || !overDelete())
+    {
+        // keep the edges of the PAG only, and solve again
+        std::vector<bool> derived(grammar.getNumLabels());
+        for (EdgeLabel lbl = 0; lbl < grammar.getNumLabels(); lbl++)
+            derived[lbl] = !grammar.isTerminal(lbl);
+        for (const CFLREdge &edge : edges)
+            graph->removeEdge(edge.src, edge.dst, edge.label);
+        graph->removeLabels(derived);
+        workList.clear();
+        solve();
+        return;
+    }
+
+    for (const CFLREdge &edge : overDeleted)
+    {
+        if (isDerivable(edge) && graph->addEdge(edge.src, edge.dst, edge.label))
+            workList.push(edge);
+    }
+    resumeWorklist();
+}
+
+
+/// Semi-naive closure over boolean matrices: in each round, a production A B -> C only joins the facts new in the
+/// previous round with all the facts, i.e., C |= dA.B + A.dB, and the new facts of C are what is not in C yet.
+/// A join ORs whole rows of the right operand, 64 columns per word.
+void CFLR::solveMatrix()
+{
+    assert(graph && "CFLR graph not built yet.");
+    const unsigned numNodes = graph->getNodeNum();
+    const EdgeLabel numLabels = grammar.getNumLabels();
+    std::vector<BitMatrix> full(numLabels, BitMatrix(numNodes));
+    std::vector<BitMatrix> delta(numLabels, BitMatrix(numNodes));
+
+    for (unsigned node = 0; node < numNodes; node++)
+    {
+        const CFLRGraph::AdjRows &rows = graph->getSuccRows(node);
+        if (rows.empty())
+            continue;
+        for (const CFLRAdj &row : rows)
+        {
+            for (unsigned dst : row.nodes)
+                full[row.label].set(node, dst);
+        }
+        for (EdgeLabel lbl : grammar.getEpsilonLabels())
+            full[lbl].set(node, node);
+    }
+    for (EdgeLabel lbl = 0; lbl < numLabels; lbl++)
+        delta[lbl] = full[lbl];
+
+    bool changed = true;
+    while (changed)
+    {
+        std::vector<BitMatrix> derived(numLabels, BitMatrix(numNodes));
+        for (auto &ur : grammar.getUnaryRules())
+            derived[ur.second].unionWith(delta[ur.first]);
+        for (auto &br : grammar.getBinaryRules())
+        {
+            EdgeLabel A = std::get<0>(br), B = std::get<1>(br), C = std::get<2>(br);
+            derived[C].addProduct(delta[A], full[B]);
+            derived[C].addProduct(full[A], delta[B]);
+        }
+        changed = false;
+        for (EdgeLabel lbl = 0; lbl < numLabels; lbl++)
+        {
+            derived[lbl].subtract(full[lbl]);
+            full[lbl].unionWith(derived[lbl]);
+            changed |= !derived[lbl].empty();
+            delta[lbl] = std::move(derived[lbl]);
+        }
+    }
+
+    // the derived relations go back to the graph, where dumpResult and the other clients find them
+    for (EdgeLabel lbl = 0; lbl < numLabels; lbl++)
+    {
+        for (unsigned src = 0; src < numNodes; src++)
+            full[lbl].forEachInRow(src, [&](unsigned dst) { graph->addEdge(src, dst, lbl); });
+    }
+    solved = true;
+}
+
+
+/// A reusable barrier for the threads of the parallel solver
+class ThreadBarrier
+{
+public:
+    explicit ThreadBarrier(unsigned n) : numThreads(n)
+    {}
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        unsigned gen = generation;
+        if (++arrived == numThreads)
         {
-            for (auto &pairBC : byLeft[L])
+            arrived = 0;
+            generation++;
+            cv.notify_all();
+        }
+        else
+            cv.wait(lock, [&]() { return gen != generation; });
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    unsigned numThreads;
+    unsigned arrived = 0;
+    unsigned generation = 0;
+};
+
+
+/// Rounds of three phases separated by barriers, so that no row is read and written at the same time:
+///  1. join: each edge new in the previous round is joined with the graph, which is read-only in this phase, and
+///     the candidate edges are bucketed by the thread owning their source;
+///  2. insert: each thread adds the candidates it owns to the successor rows, which dedupes them without locks
+///     since a row has a single writer, and buckets the new edges by the thread owning their target;
+///  3. each thread adds the new edges it owns to the predecessor rows.
+/// The new edges of a thread are its worklist in the next round. A thread done with its own worklist steals chunks
+/// of the others' through their atomic cursors. The solver stops after a round deriving nothing.
+/// Every pair of edges is joined in the round where the later one is new, so the closure is the sequential one.
+void CFLR::solveParallel(unsigned numThreads)
+{
+    assert(graph && "CFLR graph not built yet.");
+    numThreads = std::max(numThreads, 1u);
+    const unsigned numNodes = graph->getNodeNum();
+    const size_t chunkSize = 256;
+    auto owner = [numThreads](unsigned node) { return node % numThreads; };
+
+    // worklists[t]: edges new in the last round whose source thread t owns
+    std::vector<std::vector<CFLREdge>> worklists(numThreads);
+    std::vector<std::atomic<size_t>> cursors(numThreads);
+    for (unsigned node = 0; node < numNodes; node++)
+    {
+        if (graph->getSuccRows(node).empty())
+            continue;
+        for (EdgeLabel lbl : grammar.getEpsilonLabels())
+            graph->addEdge(node, node, lbl);
+        for (const CFLRAdj &row : graph->getSuccRows(node))
+        {
+            for (unsigned dst : row.nodes)
+                worklists[owner(node)].push_back(CFLREdge(node, dst, row.label));
+        }
+    }
+
+    // candidates[from][to]: edges derived by thread `from` whose source thread `to` owns
+    std::vector<std::vector<std::vector<CFLREdge>>> candidates(numThreads, std::vector<std::vector<CFLREdge>>(numThreads));
+    // fresh[from][to]: edges added to the successor rows by `from` whose target thread `to` owns
+    std::vector<std::vector<std::vector<CFLREdge>>> fresh(numThreads, std::vector<std::vector<CFLREdge>>(numThreads));
+    std::vector<std::vector<CFLREdge>> nextWorklists(numThreads);
+    std::atomic<size_t> numNewEdges(0);
+    bool done = false;
+    ThreadBarrier barrier(numThreads);
+
+    auto worker = [&](unsigned t) {
+        while (true)
+        {
+            // ---- phase 1: join ----
+            auto derive = [&](unsigned src, unsigned dst, EdgeLabel lbl) {
+                if (!graph->hasEdge(src, dst, lbl))
+                    candidates[t][owner(src)].push_back(CFLREdge(src, dst, lbl));
+            };
+            for (unsigned k = 0; k < numThreads; k++)
             {
-                EdgeLabel B = pairBC.first, C = pairBC.second;
-                auto succIt = succMap.find(v);
-                if (succIt != succMap.end())
+                // own worklist first, then steal from the others
+                unsigned victim = (t + k) % numThreads;
+                const std::vector<CFLREdge> &wl = worklists[victim];
+                size_t begin;
+                while ((begin = cursors[victim].fetch_add(chunkSize)) < wl.size())
                 {
-                    auto lblIt = succIt->second.find(B);
-                    if (lblIt != succIt->second.end())
+                    size_t end = std::min(begin + chunkSize, wl.size());
+                    for (size_t i = begin; i < end; i++)
                     {
-                        for (unsigned w : lblIt->second)
+                        unsigned u = wl[i].src, v = wl[i].dst;
+                        EdgeLabel L = wl[i].label;
+                        for (EdgeLabel Lp : grammar.getUnaryByLabel(L))
+                            derive(u, v, Lp);
+                        for (auto &bc : grammar.getBinaryByLeft(L))
+                        {
+                            for (unsigned w : graph->getSuccs(v, bc.first))
+                                derive(u, w, bc.second);
+                        }
+                        for (auto &ac : grammar.getBinaryByRight(L))
                         {
-                            if (!graph->hasEdge(u, w, C))
-                            {
-                                graph->addEdge(u, w, C);
-                                workList.push(CFLREdge(u, w, C));
-                            }
+                            for (unsigned p : graph->getPreds(u, ac.first))
+                                derive(p, v, ac.second);
                         }
                     }
                 }
             }
-        }
+            barrier.wait();
 
-        // ---- Binary join: (A ; L) -> C ----
-        if (byRight.count(L))
-        {
-            for (auto &pairAC : byRight[L])
+            // ---- phase 2: successor rows of the sources owned by t ----
+            nextWorklists[t].clear();
+            for (unsigned from = 0; from < numThreads; from++)
             {
-                EdgeLabel A = pairAC.first, C = pairAC.second;
-                auto predIt = predMap.find(u);
-                if (predIt != predMap.end())
+                for (const CFLREdge &e : candidates[from][t])
                 {
-                    auto lblIt = predIt->second.find(A);
-                    if (lblIt != predIt->second.end())
+                    if (graph->insertSucc(e.src, e.dst, e.label))
                     {
-                        for (unsigned p : lblIt->second)
-                        {
-                            if (!graph->hasEdge(p, v, C))
-                            {
-                                graph->addEdge(p, v, C);
-                                workList.push(CFLREdge(p, v, C));
-                            }
-                        }
+                        nextWorklists[t].push_back(e);
+                        fresh[t][owner(e.dst)].push_back(e);
                     }
                 }
             }
+            numNewEdges += nextWorklists[t].size();
+            barrier.wait();
+
+            // ---- phase 3: predecessor rows of the targets owned by t ----
+            for (unsigned from = 0; from < numThreads; from++)
+            {
+                for (const CFLREdge &e : fresh[from][t])
+                    graph->insertPred(e.src, e.dst, e.label);
+                candidates[from][t].clear();
+                fresh[from][t].clear();
+            }
+            barrier.wait();
+
+            if (t == 0)
+            {
+                worklists.swap(nextWorklists);
+                for (std::atomic<size_t> &cursor : cursors)
+                    cursor = 0;
+                graph->countEdges(numNewEdges);
+                done = (numNewEdges == 0);
+                numNewEdges = 0;
+            }
+            barrier.wait();
+            if (done)
+                return;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < numThreads; t++)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (std::thread &th : threads)
+        th.join();
+    solved = true;
+}
+
+
+/// On a bidirected graph, i.e., with a reverse Ci edge for every Oi edge and a reverse plain edge for every plain
+/// one, Dyck-reachability is an equivalence, computed with union-find in near-linear time (Chatterjee et al.,
+/// POPL'18): the ends of a plain edge are equivalent, and so are two nodes with Oi edges into the same class,
+/// since Oi D Ci joins them through the reverse edge. A class merge also merges the lists of Oi sources of the
+/// two classes, and a class whose list holds two or more classes is processed again.
+/// The D edges of every pair of equivalent nodes are then added, as the other solvers do; the labels the
+/// normalisation adds for the parentheses are left out.
+void CFLR::solveDyck()
+{
+    assert(graph && "CFLR graph not built yet.");
+    DyckForm form;
+    const unsigned numNodes = graph->getNodeNum();
+    auto isBidirected = [&]() {
+        std::vector<EdgeLabel> reverseOf(grammar.getNumLabels(), grammar.getNumLabels());
+        std::vector<bool> isPlain(grammar.getNumLabels(), false);
+        for (auto &paren : form.parens)
+        {
+            reverseOf[paren.first] = paren.second;
+            reverseOf[paren.second] = paren.first;
+        }
+        for (EdgeLabel t : form.plain)
+            isPlain[t] = true;
+        for (unsigned u = 0; u < numNodes; u++)
+        {
+            for (const CFLRAdj &row : graph->getSuccRows(u))
+            {
+                for (unsigned v : row.nodes)
+                {
+                    if (reverseOf[row.label] < grammar.getNumLabels() && !graph->hasEdge(v, u, reverseOf[row.label]))
+                        return false;
+                    if (isPlain[row.label] && std::none_of(form.plain.begin(), form.plain.end(),
+                                                           [&](EdgeLabel t) { return graph->hasEdge(v, u, t); }))
+                        return false;
+                }
+            }
+        }
+        return true;
+    };
+    if (!grammar.getDyckForm(form) || !isBidirected())
+    {
+        SVFUtil::errs() << "not a bidirected Dyck problem, solved with the worklist solver\n";
+        solve();
+        return;
+    }
+
+    const unsigned numParens = form.parens.size();
+    std::vector<unsigned> parent(numNodes), size(numNodes, 1);
+    // sources[K * numParens + i]: nodes with an Oi edge into class K, or the classes they are in
+    std::vector<std::vector<unsigned>> sources(numNodes * numParens);
+    std::vector<unsigned> pending;
+    for (unsigned node = 0; node < numNodes; node++)
+        parent[node] = node;
+
+    auto find = [&](unsigned node) {
+        unsigned rep = node;
+        while (parent[rep] != rep)
+            rep = parent[rep];
+        while (parent[node] != rep)
+        {
+            unsigned next = parent[node];
+            parent[node] = rep;
+            node = next;
+        }
+        return rep;
+    };
+    auto unite = [&](unsigned a, unsigned b) {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return;
+        if (size[a] < size[b])
+            std::swap(a, b);
+        parent[b] = a;
+        size[a] += size[b];
+        bool again = false;
+        for (unsigned i = 0; i < numParens; i++)
+        {
+            std::vector<unsigned> &to = sources[a * numParens + i], &from = sources[b * numParens + i];
+            if (to.size() < from.size())
+                to.swap(from);
+            to.insert(to.end(), from.begin(), from.end());
+            std::vector<unsigned>().swap(from);
+            again |= to.size() > 1;
+        }
+        if (again)
+            pending.push_back(a);
+    };
+
+    for (unsigned u = 0; u < numNodes; u++)
+    {
+        for (unsigned i = 0; i < numParens; i++)
+        {
+            for (unsigned v : graph->getSuccs(u, form.parens[i].first))
+                sources[v * numParens + i].push_back(u);
+        }
+    }
+    for (unsigned u = 0; u < numNodes; u++)
+    {
+        for (EdgeLabel t : form.plain)
+        {
+            for (unsigned v : graph->getSuccs(u, t))
+                unite(u, v);
+        }
+        pending.push_back(u);
+    }
+
+    while (!pending.empty())
+    {
+        unsigned cls = pending.back();
+        pending.pop_back();
+        if (find(cls) != cls)
+            continue;   // processed as part of the class it joined
+        for (unsigned i = 0; i < numParens; i++)
+        {
+            std::vector<unsigned> srcs;
+            srcs.swap(sources[find(cls) * numParens + i]);
+            if (srcs.empty())
+                continue;
+            unsigned first = srcs[0];
+            for (unsigned src : srcs)
+                unite(first, src);
+            // one source stands for all of them now, and the class may have changed with the merges
+            sources[find(cls) * numParens + i].push_back(find(first));
+        }
+    }
+
+    std::vector<std::vector<unsigned>> classes(numNodes);
+    for (unsigned node = 0; node < numNodes; node++)
+    {
+        if (!graph->getSuccRows(node).empty())
+            classes[find(node)].push_back(node);
+    }
+    for (const std::vector<unsigned> &cls : classes)
+    {
+        for (unsigned u : cls)
+        {
+            for (unsigned v : cls)
+                graph->addEdge(u, v, form.label);
         }
     }
+    solved = true;
 }
@@ -7,6 +7,7 @@
 #include "Util/CommandLine.h"
 #include "Util/Options.h"
 #include "WPA/Andersen.h"
+#include "MSSA/SVFGBuilder.h"
 
 using namespace SVF;
 using namespace SVFUtil;
@@ -39,7 +40,8 @@ int main(int argc, char** argv) {
     SVFIRBuilder builder;
     SVFIR* svfir = builder.build();
 
-    CallGraph* callgraph = AndersenWaveDiff::createAndersenWaveDiff(svfir)->getCallGraph();
+    AndersenWaveDiff* ander = AndersenWaveDiff::createAndersenWaveDiff(svfir);
+    CallGraph* callgraph = ander->getCallGraph();
     builder.updateCallGraph(callgraph);
 
     /// ICFG
@@ -48,6 +50,10 @@ int main(int argc, char** argv) {
     icfg->dump(moduleNameVec[0] + ".icfg");
 
     SSE* sse = new SSE(svfir, icfg);
+    /// the SVFG is owned by the builder, which has to outlive the analysis
+    SVFGBuilder svfBuilder;
+    if (SSEOptions::Sparse())
+        sse->setSVFG(svfBuilder.buildFullSVFG(ander));
     sse->analyse();
 
     SVF::LLVMModuleSet::releaseLLVMModuleSet();
@@ -7,24 +7,138 @@
 #define ANSWERS_SSEHEADER_H
 
 #include "SVF-LLVM/SVFIRBuilder.h"
+#include "Util/CommandLine.h"
+#include "Graphs/SVFG.h"
 #include "SSEZ3Mgr.h"
+#include "SSEInterval.h"
+#include "SSEPathStore.h"
 #include <stdlib.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
 
 namespace SVF {
 
+/// Command-line options of the SSE engine
+class SSEOptions {
+public:
+    /// Fold statements with constant operands in the translator instead of sending them to Z3
+    static const Option<bool> ConstFold;
+    /// Decide branches with an interval domain before asking Z3
+    static const Option<bool> IntervalFilter;
+    /// Print the statistics of the engine
+    static const Option<bool> PrintStat;
+    /// Only translate the statements in the value-flow slice of each assertion
+    static const Option<bool> Sparse;
+    /// Start from the entry of the assertion's function and widen to callers on counterexamples
+    static const Option<bool> Modular;
+    /// Defer the feasibility checks of branches that do not depend on symbolic inputs
+    static const Option<bool> Lazy;
+    /// Checkpoint file of the exploration state
+    static const Option<std::string> Checkpoint;
+    /// Number of paths between two checkpoints
+    static const Option<u32_t> CheckpointInterval;
+    /// Resume from the checkpoint file
+    static const Option<bool> Resume;
+    /// Number of worker processes sharing the assertions
+    static const Option<u32_t> Jobs;
+    /// File receiving the results as JSON lines
+    static const Option<std::string> Jsonl;
+    /// Keep the enumerated paths in memory
+    static const Option<bool> KeepPaths;
+    /// Keep path hashes instead of a prefix trie
+    static const Option<bool> PathHash;
+    /// File receiving the paths in hash mode
+    static const Option<std::string> PathSpill;
+    /// Use the recursive path enumeration
+    static const Option<bool> RecursiveDFS;
+    /// Benchmark the path enumerations
+    static const Option<bool> BenchDFS;
+    /// Latency threshold of the solver portfolio
+    static const Option<u32_t> Portfolio;
+    /// Reuse solvers popped back to a base scope instead of resetting them
+    static const Option<bool> SolverPool;
+};
+
+/// Counters of the SSE engine, reported with -sse-stat
+struct SSEStat {
+    u32_t numPaths = 0;             ///< paths reaching a sink
+    u32_t numSolverChecks = 0;      ///< satisfiability checks sent to Z3
+    u32_t numConstBranches = 0;     ///< branches decided by constant folding
+    u32_t numIntervalBranches = 0;  ///< branches decided by the interval domain, i.e., solver checks saved
+    u32_t numCollapsedPaths = 0;    ///< paths skipped since they only differ from a translated one outside the slice
+    u32_t numDeferredChecks = 0;    ///< branch checks deferred since the condition does not depend on an input
+    u32_t numBatchedChecks = 0;     ///< solver checks covering deferred branches
+    u32_t numWidenings = 0;         ///< modular runs whose counterexample made the analysis move to the callers
+    u32_t numResumedSinks = 0;      ///< assertions already done according to the checkpoint resumed from
+    u32_t numPortfolioRaces = 0;    ///< checks raced on the solver portfolio after exceeding the threshold
+
+    SSEStat& operator+=(const SSEStat& rhs) {
+        numPaths += rhs.numPaths;
+        numSolverChecks += rhs.numSolverChecks;
+        numConstBranches += rhs.numConstBranches;
+        numIntervalBranches += rhs.numIntervalBranches;
+        numCollapsedPaths += rhs.numCollapsedPaths;
+        numDeferredChecks += rhs.numDeferredChecks;
+        numBatchedChecks += rhs.numBatchedChecks;
+        numWidenings += rhs.numWidenings;
+        numResumedSinks += rhs.numResumedSinks;
+        numPortfolioRaces += rhs.numPortfolioRaces;
+        return *this;
+    }
+};
+
+/// Verification results of one assertion
+struct SinkResult {
+    u32_t numPaths = 0;     ///< paths reaching the assertion
+    u32_t numVerified = 0;  ///< feasible paths on which the assertion holds
+    u32_t numFailed = 0;    ///< feasible paths with a counterexample
+    u32_t numCollapsed = 0; ///< paths skipped by slicing
+    double solverMs = 0;    ///< time spent in the solver
+
+    SinkResult& operator+=(const SinkResult& rhs) {
+        numPaths += rhs.numPaths;
+        numVerified += rhs.numVerified;
+        numFailed += rhs.numFailed;
+        numCollapsed += rhs.numCollapsed;
+        solverMs += rhs.solverMs;
+        return *this;
+    }
+    SinkResult& operator-=(const SinkResult& rhs) {
+        numPaths -= rhs.numPaths;
+        numVerified -= rhs.numVerified;
+        numFailed -= rhs.numFailed;
+        numCollapsed -= rhs.numCollapsed;
+        solverMs -= rhs.solverMs;
+        return *this;
+    }
+};
+
 class SSE {
 public:
     typedef std::vector<const ICFGNode*> CallStack;
     typedef std::pair<const ICFGEdge*, CallStack> ICFGEdgeStackPair;
+    typedef std::pair<const ICFGEdge*, const PhiStmt*> ICFGEdgePhiPair;
 
     /// Constructor
     SSE(SVFIR* s, ICFG* i)
             : svfir(s)
             , icfg(i) {
         z3Mgr = new Z3SSEMgr(s);
+        z3Mgr->setConstFolding(SSEOptions::ConstFold());
+        z3Mgr->setTrackInputs(SSEOptions::Lazy());
+        z3Mgr->setPortfolioThreshold(SSEOptions::Portfolio());
+        z3Mgr->setSolverPooling(SSEOptions::SolverPool());
+        intervals = SSEOptions::IntervalFilter() ? new IntervalDomain(getCtx()) : nullptr;
+        paths = new PathStore(SSEOptions::PathHash(), SSEOptions::PathSpill());
     }
     /// Destructor
     virtual ~SSE() {
+        delete paths;
+        delete intervals;
         delete z3Mgr;
     }
 
@@ -52,8 +166,12 @@ public:
 
     /// reset z3 solver
     virtual void resetSolver() {
-        getSolver().reset();
+        z3Mgr->resetSolver();
+        z3Mgr->resetPathState();
+        if (intervals)
+            intervals->clear();
         callingCtx.clear();
+        deferredChecks = false;
     }
 
     /// TODO: Implementing the collection the ICFG paths
@@ -62,8 +180,65 @@ public:
     /// Depth-first-search ICFGTraversal on ICFG from src node to snk node
     void reachability(const ICFGEdge* curNode, const ICFGNode* snk);
 
+    /// The two implementations of reachability, selected with -sse-recursive-dfs
+    void reachabilityRecursive(const ICFGEdge* curEdge, const ICFGNode* snk);
+    void reachabilityIterative(const ICFGEdge* startEdge, const ICFGNode* snk);
+
+    /// Handle a path reaching the sink
+    void reachSink();
+
+    /// Push/pop an edge on the path of the iterative DFS
+    bool enterEdge(const ICFGEdge* curEdge, const ICFGNode* snk);
+    void leaveEdge(const ICFGEdge* curEdge);
+
+    /// Time the path enumeration of both DFS implementations
+    void benchmarkDFS();
+
     void analyse();
 
+    /// Check one assertion on all paths from src
+    void analyseSink(const ICFGNode* src, const ICFGNode* sink);
+
+    /// Check one assertion starting from the entry of its function with havoced parameters and globals,
+    /// moving on to the callers only for the entries where a (possibly spurious) counterexample is found
+    void analyseModular(const ICFGNode* src, const ICFGNode* sink);
+
+    /// Run the havoced analysis from a function entry, return true if the assertion holds on all paths
+    bool analyseHavoced(const FunEntryICFGNode* entry, const ICFGNode* sink);
+
+    /// Encode the addresses of globals and constants, but not the values stored in the globals
+    void translateGlobalAddresses();
+
+    /// Encode the global initialisers, and the global addresses of havoced runs, once into the base scopes
+    void encodeBaseScopes();
+
+    /// Add the current path to the paths kept for getPaths()
+    void keepPath();
+
+    /// Stream the result of a path or of an assertion as a JSON line, if enabled
+    void emitPathResult(const ICFGNode* sink, u32_t pathId, const char* verdict);
+    void emitSinkResult(const ICFGNode* sink);
+    void emitJson(const std::string& record);
+
+    /// Analyse an assertion in the mode selected on the command line
+    void analyseAssertion(const ICFGNode* src, const ICFGNode* sink);
+
+    /// Fork -sse-jobs workers and hand them the assertions one at a time
+    void analyseSharded(const ICFGNode* src, const std::vector<const ICFGNode*>& todo);
+
+    /// Loop of a worker process: analyse the assertions sent by the coordinator until told to stop
+    void runShardWorker(const ICFGNode* src, const std::vector<const ICFGNode*>& todo, int taskFd);
+
+    /// Send the output, statistics and results gathered since the last call to the coordinator
+    void sendShardResult(bool failed, bool last);
+
+    /// Write a checkpoint every -sse-checkpoint-interval paths
+    void tickCheckpoint();
+
+    /// Save/restore the exploration state
+    void writeCheckpoint(const std::string& file);
+    bool readCheckpoint(const std::string& file);
+
     virtual void handleCall(const CallCFGEdge* call);
     virtual void handleRet(const RetCFGEdge* ret);
     virtual bool handleIntra(const IntraCFGEdge* edge) {
@@ -82,6 +257,34 @@ public:
     bool handleNonBranch(const IntraCFGEdge* edge);
     bool handleBranch(const IntraCFGEdge* edge);
 
+    /// Precompute the operands selected by each PhiStmt for each of its incoming ICFG edges
+    void buildPhiOperandTable();
+
+    /// Return the operands of a PhiStmt that flow in along an ICFG edge
+    const std::vector<NodeID>& getPhiOperands(const ICFGEdge* edge, const PhiStmt* phi);
+
+    /// Set the SVFG used to slice the program for each assertion (sparse mode)
+    inline void setSVFG(SVFG* g) {
+        svfg = g;
+    }
+
+    /// Compute the backward value-flow slice of an assertion and of the branch conditions sharing nodes with it
+    void computeSlice(const ICFGNode* sink);
+
+    /// Return true if a statement has to be translated, i.e., it is in the slice of the current assertion
+    bool inSlice(const SVFStmt* stmt) const;
+
+    /// Return true if the condition of a branch has to be translated, i.e., it is in the slice of the current assertion
+    bool isRelevantBranch(const IntraCFGEdge* edge) const;
+
+    /// What a path translates under the slice of the current assertion: the nodes with statements in the slice,
+    /// with the edge entering them if it selects phi operands, and the call, return and relevant branch edges
+    typedef std::vector<std::pair<const ICFGNode*, const ICFGEdge*>> SliceKey;
+    SliceKey getSliceKey(const std::vector<const ICFGEdge*>& path) const;
+
+    /// Return true if the assertion holds on the constraints of the path, without reporting anything
+    bool assertHolds(const ICFGNode* inode);
+
     /// Encode the path into Z3 constraints and return true if the path is feasible, false otherwise.
     bool translatePath(std::vector<const ICFGEdge*>& path);
 
@@ -94,12 +297,22 @@ public:
         DBOP(std::cout << "\n## Analyzing " << callnode->toString() << "\n");
         z3::expr arg0 = getZ3Expr(callnode->getActualParms().at(0)->getId());
         addToSolver(arg0 == getCtx().int_val(0));
-        if (getSolver().check() != z3::unsat) {
+        if (checkSolver() != z3::unsat) {
             DBOP(printExprValues());
+            if (jsonOut)
+                lastCex = z3Mgr->getModel().to_string();
+            // a counterexample of a havoced run may be spurious, the caller decides whether to widen
+            if (havocRun) {
+                havocCex = true;
+                return false;
+            }
             std::stringstream ss;
             ss << "The assertion is unsatisfiable!! ("<< inode->toString() << ")" << "\n";
-            ss << "Counterexample: " << getSolver().get_model() << "\n";
-            SVFUtil::outs() << ss.str() << std::endl;
+            ss << "Counterexample: " << z3Mgr->getModel() << "\n";
+            report(ss.str());
+            // a worker hands over what it has found before the assertion below stops it
+            if (shardFd >= 0)
+                sendShardResult(true, false);
             assert(false);
             return false;
         }
@@ -107,13 +320,32 @@ public:
             DBOP(printExprValues());
             std::stringstream ss;
             ss << "The assertion is successfully verified!! ("<< inode->toString() << ")" << "\n";
-            SVFUtil::outs() << ss.str() << std::endl;
+            report(ss.str());
             return true;
         }
     }
 
+    /// Print a verification result, or keep it until the havoced runs of the assertion are conclusive
+    void report(const std::string& msg) {
+        if (havocRun)
+            havocReport += msg + "\n";
+        else if (shardFd >= 0)
+            shardOutput += msg + "\n";
+        else
+            SVFUtil::outs() << msg << std::endl;
+    }
+
+    /// Print text, or keep it for the coordinator in a worker process
+    void writeOutput(const std::string& text) {
+        if (shardFd >= 0)
+            shardOutput += text;
+        else
+            SVFUtil::outs() << text;
+    }
+
+    /// Return the enumerated paths, only kept with -sse-keep-paths
     std::set<std::string> getPaths() {
-        return paths;
+        return paths->getPaths();
     }
 
     void pushCallingCtx(const ICFGNode* c) {
@@ -134,10 +366,47 @@ public:
 
     /// Add expr to Z3 solver
     void addToSolver(z3::expr e) {
+        if (e.is_true())
+            return;
         DBOP(std::cout << "==> " << e.simplify() << "\n");
         getSolver().add(e);
     }
 
+    /// Encode the assignment "lhs = rhs" of a ValVar, folding it if rhs is a constant
+    inline void assign(NodeID lhs, z3::expr rhs) {
+        addToSolver(z3Mgr->assignZ3Expr(lhs, callingCtx, rhs));
+        if (intervals)
+            intervals->assign(z3Mgr->getSymZ3Expr(lhs, callingCtx), rhs);
+    }
+
+    /// Check the constraints added so far
+    inline z3::check_result checkSolver() {
+        stat.numSolverChecks++;
+        auto start = std::chrono::steady_clock::now();
+        z3::check_result res = z3Mgr->check();
+        if (z3Mgr->lastCheckRaced())
+            stat.numPortfolioRaces++;
+        solverTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return res;
+    }
+
+    /// Check the branch conditions whose check has been deferred, return false if the path is infeasible
+    inline bool checkDeferred() {
+        if (!deferredChecks)
+            return true;
+        deferredChecks = false;
+        stat.numBatchedChecks++;
+        return checkSolver() != z3::unsat;
+    }
+
+    /// Print the statistics of the engine
+    void printStat() const;
+
+    /// Return true if statements with constant operands are evaluated by the translator
+    inline bool constFolding() const {
+        return z3Mgr->isConstFolding();
+    }
+
     /// Return Z3 expression based on ValVar ID
     inline z3::expr getZ3Expr(NodeID idx) const {
         return z3Mgr->getZ3Expr(idx, callingCtx);
@@ -163,15 +432,68 @@ public:
 private:
     Z3SSEMgr* z3Mgr;
     ICFG* icfg;
-    std::set<std::string> paths;
+    PathStore* paths;
+    std::vector<uint32_t> pathNodes;    ///< ids of the nodes of the path being kept
 
 protected:
     SVFIR* svfir;
+    IntervalDomain* intervals;  ///< interval abstraction of the current path, null if disabled
+    SSEStat stat;
     Set<ICFGEdgeStackPair> visited;
     CallStack callstack;
     CallStack callingCtx;
     std::vector<const ICFGEdge*> path;
 
+    /// Frame of the iterative DFS
+    struct DFSFrame {
+        enum Restore { Keep, PopCallSite, PushCallSite };
+        const ICFGEdge* edge;               ///< edge entered by the frame
+        ICFGNode::const_iterator next;      ///< next out-edge of the edge's destination to visit
+        ICFGNode::const_iterator end;
+        u32_t childIdx;                     ///< index of `next` among the out-edges
+        Restore restore;                    ///< how to restore the call stack when the frame is left
+        const ICFGNode* callSite;
+    };
+    std::vector<DFSFrame> dfsStack;     ///< frames of the iterative DFS
+    bool dfsCountOnly = false;          ///< count the paths instead of translating them, for benchmarking
+    u64_t dfsPathCount = 0;
+    Map<ICFGEdgePhiPair, std::vector<NodeID>> phiOperandMap;  ///< (incoming edge, phi) -> selected operands
+
+    SVFG* svfg = nullptr;                   ///< value-flow graph for slicing, null if not in sparse mode
+    Map<NodeID, const VFGNode*> defNodes;   ///< SVFVar -> SVFG node defining it
+    Set<const VFGNode*> baseSliceNodes;     ///< slice of the operands read without a value-flow edge, in every slice
+    std::vector<std::pair<NodeID, Set<const VFGNode*>>> condSlices;     ///< branch condition -> its slice
+    Set<const SVFStmt*> sliceStmts;         ///< statements in the slice of the current assertion
+    NodeBS sliceVars;                       ///< SVFVars defined in the slice of the current assertion
+    NodeBS relevantConds;                   ///< branch conditions in the slice of the current assertion
+    std::set<SliceKey> slicedPaths;         ///< keys of the paths whose verdict holds for every path with that key
+    bool fullTranslation = false;           ///< a path is translated again without slicing
+
+    bool deferredChecks = false;        ///< branch conditions have been added without checking them
+    bool encodingBase = false;          ///< the statements being translated are shared by all paths
+    bool havocRun = false;              ///< the current run starts at a function entry with havoced inputs
+    bool havocCex = false;              ///< the current havoced run has found a counterexample
+    std::string havocReport;            ///< results of the havoced runs of the current assertion
+
+    std::map<NodeID, SinkResult> sinkResults;   ///< assertion -> results
+    Set<NodeID> doneSinks;              ///< assertions whose paths have all been explored
+    NodeID curSinkId = 0;               ///< assertion being explored
+    std::vector<u32_t> frontier;        ///< index of each edge of the current path among its source's out-edges
+    std::vector<u32_t> resumeFrontier;  ///< frontier of the checkpoint being resumed
+    bool resuming = false;              ///< the traversal is skipping what the resumed checkpoint has done
+    u32_t pathsSinceCheckpoint = 0;
+
+    int shardFd = -1;                   ///< pipe to the coordinator in a worker process, -1 otherwise
+    u32_t shardSinkIdx = 0;             ///< index of the assertion the worker is analysing
+    std::string shardOutput;            ///< output of the worker not yet sent to the coordinator
+    std::string shardJson;              ///< JSON lines of the worker not yet sent to the coordinator
+    SinkResult shardSent;               ///< results of the current assertion already sent to the coordinator
+
+    std::ostream* jsonOut = nullptr;    ///< stream of the JSON lines results, null if disabled
+    std::ofstream jsonStream;
+    double solverTime = 0;              ///< seconds spent in the solver on the current path
+    std::string lastCex;                ///< model of the last counterexample
+
     std::set<const ICFGNode*> sources;
     std::set<const ICFGNode*> sinks;
 };
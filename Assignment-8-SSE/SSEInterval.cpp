@@ -0,0 +1,295 @@
+/**
+ * SSEInterval.cpp
+ * @author kisslune
+ */
+
+#include "SSEInterval.h"
+#include <algorithm>
+
+using namespace SVF;
+
+/// Saturate a wide result to the int64 range; anything beyond a bound is treated as infinite
+static inline int64_t clampBound(__int128 v) {
+    if (v <= IntervalValue::minusInf)
+        return IntervalValue::minusInf;
+    if (v >= IntervalValue::plusInf)
+        return IntervalValue::plusInf;
+    return (int64_t)v;
+}
+
+static inline int64_t addBound(int64_t a, int64_t b, int64_t inf) {
+    if (a == inf || b == inf)
+        return inf;
+    return clampBound((__int128)a + b);
+}
+
+IntervalValue IntervalValue::operator+(const IntervalValue& rhs) const {
+    if (isBottom() || rhs.isBottom())
+        return bottom();
+    return IntervalValue(addBound(lb, rhs.lb, minusInf), addBound(ub, rhs.ub, plusInf));
+}
+
+IntervalValue IntervalValue::operator-() const {
+    if (isBottom())
+        return bottom();
+    return IntervalValue(clampBound(-(__int128)ub), clampBound(-(__int128)lb));
+}
+
+IntervalValue IntervalValue::operator-(const IntervalValue& rhs) const {
+    return *this + (-rhs);
+}
+
+IntervalValue IntervalValue::operator*(const IntervalValue& rhs) const {
+    if (isBottom() || rhs.isBottom())
+        return bottom();
+    // the infinities are the int64 extremes, so their products with anything but 0 saturate to an infinity
+    __int128 c[4] = {(__int128)lb * rhs.lb, (__int128)lb * rhs.ub, (__int128)ub * rhs.lb, (__int128)ub * rhs.ub};
+    return IntervalValue(clampBound(*std::min_element(c, c + 4)), clampBound(*std::max_element(c, c + 4)));
+}
+
+IntervalValue IntervalDomain::eval(const z3::expr& e) const {
+    int64_t n;
+    if (e.is_numeral())
+        return e.is_numeral_i64(n) ? IntervalValue(n) : IntervalValue::top();
+    if (!e.is_app() || !e.is_int())
+        return IntervalValue::top();
+
+    IntervalValue known = IntervalValue::top();
+    auto it = itvMap.find(e.id());
+    if (it != itvMap.end())
+        known = it->second;
+    if (known.isConst() || known.isBottom())
+        return known;
+
+    IntervalValue structural = IntervalValue::top();
+    switch (e.decl().decl_kind()) {
+    case Z3_OP_ADD:
+        structural = eval(e.arg(0));
+        for (unsigned i = 1; i < e.num_args(); i++)
+            structural = structural + eval(e.arg(i));
+        break;
+    case Z3_OP_SUB:
+        structural = eval(e.arg(0));
+        for (unsigned i = 1; i < e.num_args(); i++)
+            structural = structural - eval(e.arg(i));
+        break;
+    case Z3_OP_MUL:
+        structural = eval(e.arg(0));
+        for (unsigned i = 1; i < e.num_args(); i++)
+            structural = structural * eval(e.arg(i));
+        break;
+    case Z3_OP_UMINUS:
+        structural = -eval(e.arg(0));
+        break;
+    case Z3_OP_ITE:
+        switch (evalCond(e.arg(0))) {
+        case IntervalCond::True:
+            structural = eval(e.arg(1));
+            break;
+        case IntervalCond::False:
+            structural = eval(e.arg(2));
+            break;
+        default:
+            structural = eval(e.arg(1)).join(eval(e.arg(2)));
+        }
+        break;
+    default:
+        break;
+    }
+    return known.meet(structural);
+}
+
+IntervalCond IntervalDomain::evalCond(const z3::expr& cond) const {
+    if (cond.is_true())
+        return IntervalCond::True;
+    if (cond.is_false())
+        return IntervalCond::False;
+    if (!cond.is_app())
+        return IntervalCond::Unknown;
+
+    Z3_decl_kind kind = cond.decl().decl_kind();
+    if (kind == Z3_OP_NOT) {
+        IntervalCond c = evalCond(cond.arg(0));
+        if (c == IntervalCond::Unknown || c == IntervalCond::Infeasible)
+            return c;
+        return c == IntervalCond::True ? IntervalCond::False : IntervalCond::True;
+    }
+    if (cond.num_args() != 2 || !cond.arg(0).is_int())
+        return IntervalCond::Unknown;
+
+    IntervalValue l = eval(cond.arg(0));
+    IntervalValue r = eval(cond.arg(1));
+    if (l.isBottom() || r.isBottom())
+        return IntervalCond::Infeasible;  // not negated into True by an enclosing not
+    switch (kind) {
+    case Z3_OP_EQ:
+        if (l.isConst() && r.isConst() && l.getLB() == r.getLB())
+            return IntervalCond::True;
+        if (l.meet(r).isBottom())
+            return IntervalCond::False;
+        break;
+    case Z3_OP_DISTINCT:
+        if (l.isConst() && r.isConst() && l.getLB() == r.getLB())
+            return IntervalCond::False;
+        if (l.meet(r).isBottom())
+            return IntervalCond::True;
+        break;
+    case Z3_OP_LT:
+        if (l.getUB() < r.getLB())
+            return IntervalCond::True;
+        if (l.getLB() >= r.getUB())
+            return IntervalCond::False;
+        break;
+    case Z3_OP_LE:
+        if (l.getUB() <= r.getLB())
+            return IntervalCond::True;
+        if (l.getLB() > r.getUB())
+            return IntervalCond::False;
+        break;
+    case Z3_OP_GT:
+        if (l.getLB() > r.getUB())
+            return IntervalCond::True;
+        if (l.getUB() <= r.getLB())
+            return IntervalCond::False;
+        break;
+    case Z3_OP_GE:
+        if (l.getLB() >= r.getUB())
+            return IntervalCond::True;
+        if (l.getUB() < r.getLB())
+            return IntervalCond::False;
+        break;
+    default:
+        break;
+    }
+    return IntervalCond::Unknown;
+}
+
+void IntervalDomain::assign(const z3::expr& lhs, const z3::expr& rhs) {
+    IntervalValue itv = eval(rhs);
+    auto it = itvMap.find(lhs.id());
+    if (it != itvMap.end())
+        itv = itv.meet(it->second);
+    else
+        terms.push_back(lhs);
+    itvMap[lhs.id()] = itv;
+    if (!rhs.is_numeral()) {
+        terms.push_back(rhs);
+        defMap[lhs.id()] = terms.size() - 1;
+    }
+}
+
+void IntervalDomain::refine(const z3::expr& e, const IntervalValue& itv) {
+    if (e.is_numeral() || !e.is_int())
+        return;
+    IntervalValue narrowed = eval(e).meet(itv);
+    if (itvMap.find(e.id()) == itvMap.end())
+        terms.push_back(e);
+    itvMap[e.id()] = narrowed;
+
+    // a variable and its definition hold the same value, e.g., two loads of the same location
+    auto d = defMap.find(e.id());
+    if (d != defMap.end()) {
+        z3::expr def = terms[d->second];
+        if (def.is_int())
+            itvMap[def.id()] = eval(def).meet(narrowed);
+    }
+}
+
+void IntervalDomain::assumeCmp(Z3_decl_kind op, const z3::expr& lhs, const z3::expr& rhs) {
+    IntervalValue l = eval(lhs);
+    IntervalValue r = eval(rhs);
+    const int64_t minusInf = IntervalValue::minusInf;
+    const int64_t plusInf = IntervalValue::plusInf;
+    IntervalValue one(1);
+    switch (op) {
+    case Z3_OP_EQ:
+        refine(lhs, r);
+        refine(rhs, l);
+        break;
+    case Z3_OP_DISTINCT:
+        // only a constant at the border of the other interval can be cut off
+        if (r.isConst() && l.getLB() == r.getLB())
+            refine(lhs, IntervalValue(l.getLB(), plusInf) + one);
+        else if (r.isConst() && l.getUB() == r.getLB())
+            refine(lhs, IntervalValue(minusInf, l.getUB()) - one);
+        if (l.isConst() && r.getLB() == l.getLB())
+            refine(rhs, IntervalValue(r.getLB(), plusInf) + one);
+        else if (l.isConst() && r.getUB() == l.getLB())
+            refine(rhs, IntervalValue(minusInf, r.getUB()) - one);
+        break;
+    case Z3_OP_LT:
+        refine(lhs, IntervalValue(minusInf, r.getUB()) - one);
+        refine(rhs, IntervalValue(l.getLB(), plusInf) + one);
+        break;
+    case Z3_OP_LE:
+        refine(lhs, IntervalValue(minusInf, r.getUB()));
+        refine(rhs, IntervalValue(l.getLB(), plusInf));
+        break;
+    case Z3_OP_GT:
+        refine(lhs, IntervalValue(r.getLB(), plusInf) + one);
+        refine(rhs, IntervalValue(minusInf, l.getUB()) - one);
+        break;
+    case Z3_OP_GE:
+        refine(lhs, IntervalValue(r.getLB(), plusInf));
+        refine(rhs, IntervalValue(minusInf, l.getUB()));
+        break;
+    default:
+        break;
+    }
+}
+
+static inline Z3_decl_kind negateCmp(Z3_decl_kind op) {
+    switch (op) {
+    case Z3_OP_EQ:
+        return Z3_OP_DISTINCT;
+    case Z3_OP_DISTINCT:
+        return Z3_OP_EQ;
+    case Z3_OP_LT:
+        return Z3_OP_GE;
+    case Z3_OP_LE:
+        return Z3_OP_GT;
+    case Z3_OP_GT:
+        return Z3_OP_LE;
+    case Z3_OP_GE:
+        return Z3_OP_LT;
+    default:
+        return Z3_OP_UNINTERPRETED;
+    }
+}
+
+void IntervalDomain::assume(const z3::expr& cond) {
+    if (!cond.is_app())
+        return;
+    Z3_decl_kind kind = cond.decl().decl_kind();
+    if (kind == Z3_OP_AND) {
+        for (unsigned i = 0; i < cond.num_args(); i++)
+            assume(cond.arg(i));
+        return;
+    }
+    bool negated = false;
+    z3::expr c = cond;
+    while (c.is_app() && c.decl().decl_kind() == Z3_OP_NOT) {
+        negated = !negated;
+        c = c.arg(0);
+    }
+    if (!c.is_app() || c.num_args() != 2 || !c.arg(0).is_int())
+        return;
+    kind = negated ? negateCmp(c.decl().decl_kind()) : c.decl().decl_kind();
+    assumeCmp(kind, c.arg(0), c.arg(1));
+
+    // "v == k" where v is defined as ite(p, t, f): p is known to hold (or not) if k matches only one of t and f
+    if (kind != Z3_OP_EQ || !c.arg(1).is_numeral())
+        return;
+    auto d = defMap.find(c.arg(0).id());
+    if (d == defMap.end())
+        return;
+    z3::expr def = terms[d->second];
+    if (!def.is_ite() || !def.arg(1).is_numeral() || !def.arg(2).is_numeral())
+        return;
+    bool isThen = z3::eq(def.arg(1), c.arg(1));
+    bool isElse = z3::eq(def.arg(2), c.arg(1));
+    if (isThen && !isElse)
+        assume(def.arg(0));
+    else if (isElse && !isThen)
+        assume(!def.arg(0));
+}
@@ -0,0 +1,120 @@
+/**
+ * SSEInterval.h
+ * @author kisslune
+ */
+
+#ifndef ANSWERS_SSEINTERVAL_H
+#define ANSWERS_SSEINTERVAL_H
+
+#include "z3++.h"
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+namespace SVF {
+
+/// A closed integer interval [lb, ub]. The int64 extremes stand for -inf/+inf, and lb > ub is the empty interval.
+class IntervalValue {
+public:
+    static constexpr int64_t minusInf = std::numeric_limits<int64_t>::min();
+    static constexpr int64_t plusInf = std::numeric_limits<int64_t>::max();
+
+    IntervalValue() : lb(minusInf), ub(plusInf) {}
+    IntervalValue(int64_t l, int64_t u) : lb(l), ub(u) {}
+    explicit IntervalValue(int64_t c) : lb(c), ub(c) {}
+
+    static IntervalValue top() {
+        return IntervalValue();
+    }
+    static IntervalValue bottom() {
+        return IntervalValue(plusInf, minusInf);
+    }
+
+    inline int64_t getLB() const {
+        return lb;
+    }
+    inline int64_t getUB() const {
+        return ub;
+    }
+    inline bool isTop() const {
+        return lb == minusInf && ub == plusInf;
+    }
+    inline bool isBottom() const {
+        return lb > ub;
+    }
+    inline bool isConst() const {
+        return lb == ub;
+    }
+    inline bool contains(int64_t c) const {
+        return lb <= c && c <= ub;
+    }
+
+    IntervalValue meet(const IntervalValue& rhs) const {
+        return IntervalValue(std::max(lb, rhs.lb), std::min(ub, rhs.ub));
+    }
+    IntervalValue join(const IntervalValue& rhs) const {
+        if (isBottom())
+            return rhs;
+        if (rhs.isBottom())
+            return *this;
+        return IntervalValue(std::min(lb, rhs.lb), std::max(ub, rhs.ub));
+    }
+
+    IntervalValue operator+(const IntervalValue& rhs) const;
+    IntervalValue operator-(const IntervalValue& rhs) const;
+    IntervalValue operator*(const IntervalValue& rhs) const;
+    IntervalValue operator-() const;
+
+private:
+    int64_t lb;
+    int64_t ub;
+};
+
+/// Result of evaluating a condition over intervals; Infeasible means the path itself is, whatever the polarity
+enum class IntervalCond { False, True, Unknown, Infeasible };
+
+/**
+ * Interval abstraction of the constraints of the current SSE path.
+ * Terms are the Z3 expressions built by the translator and are keyed by their AST ids; every keyed term is kept
+ * alive in `terms` so that its id cannot be recycled while the domain refers to it.
+ * The intervals over-approximate the solutions of the path constraints, so a condition decided here is decided
+ * for the solver as well.
+ */
+class IntervalDomain {
+public:
+    explicit IntervalDomain(z3::context& c) : terms(c) {}
+
+    /// Record "lhs = rhs"
+    void assign(const z3::expr& lhs, const z3::expr& rhs);
+
+    /// Refine the intervals with a condition that has been added to the path
+    void assume(const z3::expr& cond);
+
+    /// Return the interval of an integer term
+    IntervalValue eval(const z3::expr& e) const;
+
+    /// Evaluate a boolean term
+    IntervalCond evalCond(const z3::expr& cond) const;
+
+    /// Forget the current path
+    void clear() {
+        itvMap.clear();
+        defMap.clear();
+        terms.resize(0);
+    }
+
+private:
+    /// Narrow the interval of a term, following its definition
+    void refine(const z3::expr& e, const IntervalValue& itv);
+
+    /// Refine both sides of a comparison "lhs op rhs" assumed to hold
+    void assumeCmp(Z3_decl_kind op, const z3::expr& lhs, const z3::expr& rhs);
+
+    z3::expr_vector terms;                          ///< keeps every keyed term alive
+    std::unordered_map<unsigned, IntervalValue> itvMap;  ///< term id -> interval
+    std::unordered_map<unsigned, unsigned> defMap;       ///< variable id -> position of its definition in terms
+};
+
+} // namespace SVF
+
+#endif //ANSWERS_SSEINTERVAL_H
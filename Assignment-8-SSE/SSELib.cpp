@@ -5,26 +5,159 @@
 
 #include "SSEHeader.h"
 #include "Util/Options.h"
+#include <cstdlib>
 
 using namespace SVF;
 using namespace SVFUtil;
 using namespace llvm;
 using namespace z3;
 
+const Option<bool> SSEOptions::ConstFold(
+    "sse-const-fold",
+    "Evaluate statements with constant operands in the translator and decide constant branches locally",
+    true
+);
+
+const Option<bool> SSEOptions::IntervalFilter(
+    "sse-interval",
+    "Decide branch feasibility with an interval domain kept along the path before calling the solver",
+    true
+);
+
+const Option<bool> SSEOptions::Sparse(
+    "sse-sparse",
+    "Translate only the statements in the SVFG slice of each assertion and of the branch conditions it depends on",
+    false
+);
+
+const Option<bool> SSEOptions::Modular(
+    "sse-modular",
+    "Start each assertion at the entry of its function with havoced inputs, widening to callers on counterexamples",
+    false
+);
+
+const Option<bool> SSEOptions::Lazy(
+    "sse-lazy",
+    "Defer the solver checks of branches whose condition does not depend on symbolic inputs",
+    false
+);
+
+const Option<std::string> SSEOptions::Checkpoint(
+    "sse-checkpoint",
+    "File to periodically save the exploration state to (empty to disable checkpointing)",
+    ""
+);
+
+const Option<u32_t> SSEOptions::CheckpointInterval(
+    "sse-checkpoint-interval",
+    "Number of explored paths between two checkpoints",
+    1000
+);
+
+const Option<bool> SSEOptions::Resume(
+    "sse-resume",
+    "Resume from the file given by -sse-checkpoint if it exists",
+    false
+);
+
+const Option<u32_t> SSEOptions::Jobs(
+    "sse-jobs",
+    "Number of worker processes analysing the assertions in parallel (1 to analyse them in this process)",
+    1
+);
+
+const Option<std::string> SSEOptions::Jsonl(
+    "sse-jsonl",
+    "File to stream the per-path and per-assertion results to as JSON lines (- for stdout, empty to disable)",
+    ""
+);
+
+const Option<bool> SSEOptions::KeepPaths(
+    "sse-keep-paths",
+    "Keep every enumerated path in memory for getPaths()",
+    false
+);
+
+const Option<bool> SSEOptions::PathHash(
+    "sse-path-hash",
+    "Keep 64-bit hashes of the paths instead of a prefix trie (with -sse-keep-paths)",
+    false
+);
+
+const Option<std::string> SSEOptions::PathSpill(
+    "sse-path-spill",
+    "File receiving the full paths whose hashes are kept, so that getPaths() can list them (with -sse-path-hash)",
+    ""
+);
+
+const Option<bool> SSEOptions::RecursiveDFS(
+    "sse-recursive-dfs",
+    "Enumerate the paths with the recursive DFS instead of the iterative one",
+    false
+);
+
+const Option<bool> SSEOptions::BenchDFS(
+    "sse-bench-dfs",
+    "Compare the path enumeration throughput of the recursive and iterative DFS instead of verifying the assertions",
+    false
+);
+
+const Option<u32_t> SSEOptions::Portfolio(
+    "sse-portfolio",
+    "Race a portfolio of solver configurations on the checks taking more than this many milliseconds (0 to disable)",
+    0
+);
+
+const Option<bool> SSEOptions::SolverPool(
+    "sse-solver-pool",
+    "Reuse solvers popped back to their base scope across paths and assertions instead of resetting them",
+    true
+);
+
+const Option<bool> SSEOptions::PrintStat(
+    "sse-stat",
+    "Print the statistics of symbolic execution",
+    false
+);
+
 /// TODO: Implement your context-sensitive ICFG traversal here to traverse each program path (once for any loop) from
 /// You will need to collect each path from src node to snk node and then add the path to the `paths` set by
 /// calling the `collectAndTranslatePath` method, in which translatePath method is called.
 /// This implementation, slightly different from Assignment-1, requires ICFGNode* as the first argument.
 void SSE::reachability(const ICFGEdge* curEdge, const ICFGNode* snk) {
+    if (SSEOptions::RecursiveDFS())
+        reachabilityRecursive(curEdge, snk);
+    else
+        reachabilityIterative(curEdge, snk);
+}
+
+void SSE::reachSink() {
+    if (dfsCountOnly)
+        dfsPathCount++;
+    // the path of a checkpoint has been translated before it was written
+    else if (resuming && path.size() == resumeFrontier.size())
+        resuming = false;
+    else {
+        collectAndTranslatePath();
+        tickCheckpoint();
+    }
+}
+
+void SSE::reachabilityRecursive(const ICFGEdge* curEdge, const ICFGNode* snk) {
     /// TODO: your code starts from here
     // curEdge 的 dst 节点就是当前所在的 ICFGNode
     const ICFGNode* curNode = curEdge->getDstNode();
 
+    // a havoced run stops at its first counterexample, the assertion is then retried from the callers
+    if (havocCex)
+        return;
+
     // 从 fake 的起始边（src=nullptr）开始时，为这一次 DFS 初始化状态
     if (curEdge->getSrcNode() == nullptr) {
         visited.clear();
         path.clear();
         callstack.clear();
+        frontier.clear();
     }
 
     // 记录当前 (edge, callstack) 组合是否已在当前递归栈中出现过（防止循环）
@@ -41,21 +174,32 @@ void SSE::reachability(const ICFGEdge* curEdge, const ICFGNode* snk) {
 
     // 如果已经到达 sink，则收集路径并做翻译+断言检查
     if (curNode == snk) {
-        collectAndTranslatePath();
+        reachSink();
     }
     else {
         // 遍历所有后继边
+        u32_t depth = path.size();
+        u32_t childIdx = 0;
         for (const ICFGEdge* outEdge : curNode->getOutEdges()) {
+            u32_t idx = childIdx++;
+            // when resuming from a checkpoint, skip the subtrees explored before it was written
+            if (resuming) {
+                if (depth < resumeFrontier.size() && idx < resumeFrontier[depth])
+                    continue;
+                if (depth >= resumeFrontier.size() || idx > resumeFrontier[depth])
+                    resuming = false;
+            }
+            frontier.push_back(idx);
 
             // IntraCFGEdge：普通 intra 边，直接继续 DFS
             if (SVFUtil::isa<IntraCFGEdge>(outEdge)) {
-                reachability(outEdge, snk);
+                reachabilityRecursive(outEdge, snk);
             }
             // CallCFGEdge：遇到调用边时，往 callstack 里压入 callsite
             else if (const CallCFGEdge* callEdge = SVFUtil::dyn_cast<CallCFGEdge>(outEdge)) {
                 const ICFGNode* callSite = callEdge->getCallSite();
                 callstack.push_back(callSite);
-                reachability(callEdge, snk);
+                reachabilityRecursive(callEdge, snk);
                 callstack.pop_back();
             }
             // RetCFGEdge：只允许在与顶部 callsite 匹配时“返回”
@@ -64,17 +208,19 @@ void SSE::reachability(const ICFGEdge* curEdge, const ICFGNode* snk) {
                 if (!callstack.empty() && callstack.back() == callSite) {
                     // 模拟返回：先从 callstack 弹出，再 DFS，再恢复
                     callstack.pop_back();
-                    reachability(retEdge, snk);
+                    reachabilityRecursive(retEdge, snk);
                     callstack.push_back(callSite);
                 }
                 // 当 callstack 为空时（如顶层外部调用），允许直接通过
-                else if (callstack.empty()) {
-                    reachability(retEdge, snk);
+                // a havoced run never returns past the function it starts from
+                else if (callstack.empty() && !havocRun) {
+                    reachabilityRecursive(retEdge, snk);
                 }
             }
             else {
                 assert(false && "Unknown ICFGEdge type in reachability");
             }
+            frontier.pop_back();
         }
     }
 
@@ -86,6 +232,105 @@ void SSE::reachability(const ICFGEdge* curEdge, const ICFGNode* snk) {
     visited.erase(key);
 }
 
+/// Enter an edge as reachabilityRecursive does before visiting the successors, return false if there is nothing
+/// to visit from it, in which case the edge has already been left.
+bool SSE::enterEdge(const ICFGEdge* curEdge, const ICFGNode* snk) {
+    if (havocCex)
+        return false;
+    if (curEdge->getSrcNode() == nullptr) {
+        visited.clear();
+        path.clear();
+        callstack.clear();
+        frontier.clear();
+    }
+    if (!visited.insert(ICFGEdgeStackPair(curEdge, callstack)).second)
+        return false;
+    if (curEdge->getSrcNode() != nullptr)
+        path.push_back(curEdge);
+    if (curEdge->getDstNode() != snk)
+        return true;
+    reachSink();
+    leaveEdge(curEdge);
+    return false;
+}
+
+void SSE::leaveEdge(const ICFGEdge* curEdge) {
+    if (curEdge->getSrcNode() != nullptr)
+        path.pop_back();
+    visited.erase(ICFGEdgeStackPair(curEdge, callstack));
+}
+
+/// The same traversal as reachabilityRecursive, in the same order, with the frames on an explicit stack.
+/// A frame records the edge it has entered, the next out-edge of the edge's destination to visit and how to restore
+/// the call stack once the frame is left. The frames live in `dfsStack`, whose storage is kept across traversals.
+void SSE::reachabilityIterative(const ICFGEdge* startEdge, const ICFGNode* snk) {
+    dfsStack.clear();
+    if (!enterEdge(startEdge, snk))
+        return;
+    const ICFGNode* startNode = startEdge->getDstNode();
+    dfsStack.push_back({startEdge, startNode->OutEdgeBegin(), startNode->OutEdgeEnd(), 0, DFSFrame::Keep, nullptr});
+
+    while (!dfsStack.empty()) {
+        DFSFrame& frame = dfsStack.back();
+        // a havoced run stops at its first counterexample: every frame is left without visiting further edges
+        if (frame.next == frame.end || havocCex) {
+            DFSFrame done = frame;
+            dfsStack.pop_back();
+            leaveEdge(done.edge);
+            if (done.restore == DFSFrame::PopCallSite)
+                callstack.pop_back();
+            else if (done.restore == DFSFrame::PushCallSite)
+                callstack.push_back(done.callSite);
+            if (!dfsStack.empty())
+                frontier.pop_back();
+            continue;
+        }
+
+        const ICFGEdge* outEdge = *frame.next++;
+        u32_t idx = frame.childIdx++;
+        u32_t depth = path.size();
+        if (resuming) {
+            if (depth < resumeFrontier.size() && idx < resumeFrontier[depth])
+                continue;
+            if (depth >= resumeFrontier.size() || idx > resumeFrontier[depth])
+                resuming = false;
+        }
+
+        DFSFrame::Restore restore = DFSFrame::Keep;
+        const ICFGNode* callSite = nullptr;
+        if (const CallCFGEdge* callEdge = SVFUtil::dyn_cast<CallCFGEdge>(outEdge)) {
+            callSite = callEdge->getCallSite();
+            callstack.push_back(callSite);
+            restore = DFSFrame::PopCallSite;
+        }
+        else if (const RetCFGEdge* retEdge = SVFUtil::dyn_cast<RetCFGEdge>(outEdge)) {
+            callSite = retEdge->getCallSite();
+            if (!callstack.empty() && callstack.back() == callSite) {
+                callstack.pop_back();
+                restore = DFSFrame::PushCallSite;
+            }
+            // a havoced run never returns past the function it starts from
+            else if (!callstack.empty() || havocRun)
+                continue;
+        }
+        else
+            assert(SVFUtil::isa<IntraCFGEdge>(outEdge) && "Unknown ICFGEdge type in reachability");
+
+        frontier.push_back(idx);
+        if (enterEdge(outEdge, snk)) {
+            const ICFGNode* dst = outEdge->getDstNode();
+            // `frame` is invalidated by the push
+            dfsStack.push_back({outEdge, dst->OutEdgeBegin(), dst->OutEdgeEnd(), 0, restore, callSite});
+            continue;
+        }
+        if (restore == DFSFrame::PopCallSite)
+            callstack.pop_back();
+        else if (restore == DFSFrame::PushCallSite)
+            callstack.push_back(callSite);
+        frontier.pop_back();
+    }
+}
+
 /// TODO: collect each path once this method is called during reachability analysis, and
 /// Collect each program path from the entry to each assertion of the program. In this function,
 /// you will need (1) add each path into the paths set; (2) call translatePath to convert each path into Z3 expressions.
@@ -96,33 +341,145 @@ void SSE::collectAndTranslatePath() {
     if (path.empty())
         return;
 
+    const ICFGNode* lastNode = path.back()->getDstNode();
+    SinkResult& result = sinkResults[lastNode->getId()];
+    u32_t pathId = result.numPaths + result.numCollapsed;
+
     // 1) 把当前 path 以字符串形式加入 paths（主要用于调试/统计）
-    std::stringstream ss;
+    if (SSEOptions::KeepPaths())
+        keepPath();
+
+    SliceKey key;
+    if (svfg) {
+        key = getSliceKey(path);
+        if (slicedPaths.find(key) != slicedPaths.end()) {
+            stat.numCollapsedPaths++;
+            result.numCollapsed++;
+            emitPathResult(lastNode, pathId, "collapsed");
+            return;
+        }
+    }
+
+    // 2) 把 path 翻译成 Z3 约束
+    stat.numPaths++;
+    result.numPaths++;
+    solverTime = 0;
+    bool feasible = translatePath(path) && checkDeferred();
+    if (svfg) {
+        // The constraints of the slice, branches outside it skipped, are the same for all paths with the key, which
+        // are thus infeasible together or verified together. A counterexample on the slice is only real if one of
+        // these paths is feasible: this one is translated again in full, and the next ones are tried if it is not.
+        if (!feasible || assertHolds(lastNode))
+            slicedPaths.insert(key);
+        else {
+            resetSolver();
+            fullTranslation = true;
+            feasible = translatePath(path) && checkDeferred();
+            fullTranslation = false;
+        }
+    }
+
+    // 3) 如果路径可行，则对最后一个节点中的断言进行检查
+    const char* verdict = "infeasible";
+    if (feasible) {
+        if (assertchecking(lastNode)) {
+            result.numVerified++;
+            verdict = "verified";
+        }
+        else if (havocRun) {
+            // the counterexample may be spurious, the assertion is retried from the callers
+            verdict = "widened";
+        }
+        else {
+            result.numFailed++;
+            verdict = "failed";
+        }
+    }
+    result.solverMs += solverTime * 1000;
+    emitPathResult(lastNode, pathId, verdict);
+
+    // 4) 每条路径结束后都要重置 solver 和 callingCtx，避免约束串台
+    resetSolver();
+}
+
+void SSE::keepPath() {
+    pathNodes.clear();
     // 尝试把第一个真实起点节点也打印出来
     const ICFGEdge* firstEdge = path.front();
     if (const ICFGNode* firstSrc = firstEdge->getSrcNode()) {
-        ss << firstSrc->getId();
+        pathNodes.push_back(firstSrc->getId());
     } else {
         // 如果 src 为 nullptr（理论上只有 fake 起始边），那就从 dst 开始
-        ss << firstEdge->getDstNode()->getId();
+        pathNodes.push_back(firstEdge->getDstNode()->getId());
     }
     for (const ICFGEdge* e : path) {
-        const ICFGNode* dst = e->getDstNode();
-        ss << "->" << dst->getId();
+        pathNodes.push_back(e->getDstNode()->getId());
     }
-    paths.insert(ss.str());
-
-    // 2) 把 path 翻译成 Z3 约束
-    bool feasible = translatePath(path);
+    paths->insert(pathNodes);
+}
 
-    // 3) 如果路径可行，则对最后一个节点中的断言进行检查
-    if (feasible) {
-        const ICFGNode* lastNode = path.back()->getDstNode();
-        assertchecking(lastNode);
+/// Escape a string for a JSON string literal
+static std::string jsonEscape(const std::string& str) {
+    std::string escaped;
+    for (char c : str) {
+        switch (c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                escaped += buf;
+            }
+            else
+                escaped += c;
+        }
     }
+    return escaped;
+}
 
-    // 4) 每条路径结束后都要重置 solver 和 callingCtx，避免约束串台
-    resetSolver();
+void SSE::emitPathResult(const ICFGNode* sink, u32_t pathId, const char* verdict) {
+    if (!jsonOut)
+        return;
+    std::stringstream ss;
+    ss << "{\"type\":\"path\",\"sink\":" << sink->getId() << ",\"path\":" << pathId << ",\"verdict\":\"" << verdict
+       << "\",\"solver_ms\":" << solverTime * 1000;
+    if (std::strcmp(verdict, "failed") == 0 || std::strcmp(verdict, "widened") == 0)
+        ss << ",\"counterexample\":\"" << jsonEscape(lastCex) << "\"";
+    ss << "}";
+    emitJson(ss.str());
+}
+
+void SSE::emitSinkResult(const ICFGNode* sink) {
+    if (!jsonOut)
+        return;
+    const SinkResult& result = sinkResults[sink->getId()];
+    std::stringstream ss;
+    ss << "{\"type\":\"sink\",\"sink\":" << sink->getId() << ",\"verdict\":\""
+       << (result.numFailed > 0 ? "failed" : "verified") << "\",\"paths\":" << result.numPaths
+       << ",\"verified\":" << result.numVerified << ",\"failed\":" << result.numFailed
+       << ",\"collapsed\":" << result.numCollapsed << ",\"solver_ms\":" << result.solverMs << "}";
+    emitJson(ss.str());
+}
+
+void SSE::emitJson(const std::string& record) {
+    if (shardFd >= 0) {
+        // the coordinator owns the output file, hand the record over as soon as it is decided
+        shardJson += record + "\n";
+        sendShardResult(false, false);
+    }
+    else
+        *jsonOut << record << "\n" << std::flush;
 }
 
 /// TODO: Implement handling of function calls
@@ -143,8 +500,8 @@ void SSE::handleCall(const CallCFGEdge* calledge) {
 
     // 在 callee context 下获取形参 LHS 的表达式，并与之前 caller context 下的 RHS 相等
     for (u32_t i = 0; i < callPEs.size(); ++i) {
-        expr lhs = getZ3Expr(callPEs[i]->getLHSVarID());
-        addToSolver(lhs == preCtxExprs[i]);
+        if (inSlice(callPEs[i]))
+            assign(callPEs[i]->getLHSVarID(), preCtxExprs[i]);
     }
 }
 
@@ -162,10 +519,10 @@ void SSE::handleRet(const RetCFGEdge* retEdge) {
     // 返回到 caller：弹出 callingCtx 顶部的 callsite
     popCallingCtx();
 
-    if (const RetPE* retPE = retEdge->getRetPE()) {
+    const RetPE* retPE = retEdge->getRetPE();
+    if (retPE && inSlice(retPE)) {
         // 现在在 caller context 下获取 LHS（接收返回值的变量）
-        expr lhs = getZ3Expr(retPE->getLHSVarID());
-        addToSolver(lhs == rhs);
+        assign(retPE->getLHSVarID(), rhs);
     }
 }
 
@@ -184,15 +541,43 @@ bool SSE::handleBranch(const IntraCFGEdge* edge) {
     // 已经在 handleIntra 里保证了 edge->getCondition() 非空
     const SVFValue* condVal = edge->getCondition();
     assert(condVal && "Branch edge without condition?");
+    if (!isRelevantBranch(edge))
+        return true;
 
     expr cond = getZ3Expr(condVal->getId());
     int succVal = static_cast<int>(edge->getSuccessorCondValue());
+    // the condition has been folded into a constant, so the branch is decided without the solver
+    if (cond.is_numeral()) {
+        stat.numConstBranches++;
+        return cond.get_numeral_int64() == succVal;
+    }
     expr succ = getCtx().int_val(succVal);
 
+    // the interval domain may prove the branch (or the path) infeasible or always taken, which saves a solver check
+    if (intervals) {
+        IntervalCond taken = intervals->evalCond(cond == succ);
+        if (taken != IntervalCond::Unknown) {
+            stat.numIntervalBranches++;
+            return taken == IntervalCond::True;
+        }
+    }
+
+    // a condition fixed by the path so far is checked in a batch with the next input-dependent branch or at the sink
+    if (SSEOptions::Lazy() && !z3Mgr->dependsOnInput(cond)) {
+        addToSolver(cond == succ);
+        if (intervals)
+            intervals->assume(cond == succ);
+        deferredChecks = true;
+        stat.numDeferredChecks++;
+        return true;
+    }
+    // the check below also covers the deferred conditions
+    deferredChecks = false;
+
     // 先试探性加入 cond == succ，看该分支是否可行
     getSolver().push();
     addToSolver(cond == succ);
-    if (getSolver().check() == z3::unsat) {
+    if (checkSolver() == z3::unsat) {
         // 不可行，回滚并返回 false
         getSolver().pop();
         return false;
@@ -200,6 +585,8 @@ bool SSE::handleBranch(const IntraCFGEdge* edge) {
     // 可行，回滚临时状态再正式加入约束
     getSolver().pop();
     addToSolver(cond == succ);
+    if (intervals)
+        intervals->assume(cond == succ);
     return true;
 }
 
@@ -212,30 +599,35 @@ bool SSE::handleNonBranch(const IntraCFGEdge* edge) {
 
     for (const SVFStmt *stmt : dstNode->getSVFStmts())
     {
+        if (!inSlice(stmt))
+            continue;
+        // pointers are concretised with a model, which needs the deferred conditions to be satisfiable
+        if (SVFUtil::isa<LoadStmt, StoreStmt, GepStmt>(stmt) && !checkDeferred())
+            return false;
         if (const AddrStmt *addr = SVFUtil::dyn_cast<AddrStmt>(stmt))
         {
             // TODO: implement AddrStmt handler here
             // p = &obj
-            expr lhs = getZ3Expr(addr->getLHSVarID());
             expr rhs = getMemObjAddress(addr->getRHSVarID());
-            addToSolver(lhs == rhs);
+            assign(addr->getLHSVarID(), rhs);
         }
         else if (const CopyStmt *copy = SVFUtil::dyn_cast<CopyStmt>(stmt))
         {
             // TODO: implement CopyStmt handler here
             // x = y
-            expr lhs = getZ3Expr(copy->getLHSVarID());
             expr rhs = getZ3Expr(copy->getRHSVarID());
-            addToSolver(lhs == rhs);
+            assign(copy->getLHSVarID(), rhs);
         }
         else if (const LoadStmt *load = SVFUtil::dyn_cast<LoadStmt>(stmt))
         {
             // TODO: implement LoadStmt handler here
             // x = *p
-            expr lhs = getZ3Expr(load->getLHSVarID());
             expr rhsPtr = getZ3Expr(load->getRHSVarID());
             expr loaded = z3Mgr->loadValue(rhsPtr);
-            addToSolver(lhs == loaded);
+            // a concrete address lets select-over-store be resolved to the stored value
+            if (constFolding() && rhsPtr.is_numeral())
+                loaded = loaded.simplify();
+            assign(load->getLHSVarID(), loaded);
         }
         else if (const StoreStmt *store = SVFUtil::dyn_cast<StoreStmt>(stmt))
         {
@@ -249,13 +641,12 @@ bool SSE::handleNonBranch(const IntraCFGEdge* edge) {
         {
             // TODO: implement GepStmt handler here
             // res = gep basePtr, offset
-            expr lhs = getZ3Expr(gep->getLHSVarID());
             expr basePtr = getZ3Expr(gep->getRHSVarID());
 
             s32_t offset = z3Mgr->getGepOffset(gep, callingCtx);
             expr gepAddr = z3Mgr->getGepObjAddress(basePtr, offset);
 
-            addToSolver(lhs == gepAddr);
+            assign(gep->getLHSVarID(), gepAddr);
         }
             /// Given a CmpStmt "r = a > b"
             /// cmp->getOpVarID(0)/cmp->getOpVarID(1) returns the first/second operand, i.e., "a" and "b"
@@ -268,106 +659,291 @@ bool SSE::handleNonBranch(const IntraCFGEdge* edge) {
             // TODO: implement CmpStmt handler here
             expr op0 = getZ3Expr(cmp->getOpVarID(0));
             expr op1 = getZ3Expr(cmp->getOpVarID(1));
-            expr res = getZ3Expr(cmp->getResID());
+            expr rhs(getCtx());
             expr one = getCtx().int_val(1);
             expr zero = getCtx().int_val(0);
 
             switch (cmp->getPredicate()) {
                 case CmpStmt::ICMP_EQ:
-                    addToSolver(res == ite(op0 == op1, one, zero));
+                    rhs = ite(op0 == op1, one, zero);
                     break;
                 case CmpStmt::ICMP_NE:
-                    addToSolver(res == ite(op0 != op1, one, zero));
+                    rhs = ite(op0 != op1, one, zero);
                     break;
                 case CmpStmt::ICMP_UGT:
                 case CmpStmt::ICMP_SGT:
-                    addToSolver(res == ite(op0 > op1, one, zero));
+                    rhs = ite(op0 > op1, one, zero);
                     break;
                 case CmpStmt::ICMP_UGE:
                 case CmpStmt::ICMP_SGE:
-                    addToSolver(res == ite(op0 >= op1, one, zero));
+                    rhs = ite(op0 >= op1, one, zero);
                     break;
                 case CmpStmt::ICMP_ULT:
                 case CmpStmt::ICMP_SLT:
-                    addToSolver(res == ite(op0 < op1, one, zero));
+                    rhs = ite(op0 < op1, one, zero);
                     break;
                 case CmpStmt::ICMP_ULE:
                 case CmpStmt::ICMP_SLE:
-                    addToSolver(res == ite(op0 <= op1, one, zero));
+                    rhs = ite(op0 <= op1, one, zero);
                     break;
                 default:
                     assert(false && "Unhandled integer Cmp predicate");
             }
+            if (constFolding() && op0.is_numeral() && op1.is_numeral())
+                rhs = rhs.simplify();
+            assign(cmp->getResID(), rhs);
         }
         else if (const BinaryOPStmt *binary = SVFUtil::dyn_cast<BinaryOPStmt>(stmt))
         {
             expr op0 = getZ3Expr(binary->getOpVarID(0));
             expr op1 = getZ3Expr(binary->getOpVarID(1));
-            expr res = getZ3Expr(binary->getResID());
+            expr rhs(getCtx());
             switch (binary->getOpcode())
             {
                 case BinaryOperator::Add:
-                    addToSolver(res == op0 + op1);
+                    rhs = op0 + op1;
                     break;
                 case BinaryOperator::Sub:
-                    addToSolver(res == op0 - op1);
+                    rhs = op0 - op1;
                     break;
                 case BinaryOperator::Mul:
-                    addToSolver(res == op0 * op1);
+                    rhs = op0 * op1;
                     break;
                 case BinaryOperator::SDiv:
-                    addToSolver(res == op0 / op1);
+                    rhs = op0 / op1;
                     break;
                 case BinaryOperator::SRem:
-                    addToSolver(res == op0 % op1);
+                    rhs = op0 % op1;
                     break;
                 case BinaryOperator::Xor:
-                    addToSolver(res == bv2int(int2bv(32, op0) ^ int2bv(32, op1), 1));
+                    rhs = bv2int(int2bv(32, op0) ^ int2bv(32, op1), 1);
                     break;
                 case BinaryOperator::And:
-                    addToSolver(res == bv2int(int2bv(32, op0) & int2bv(32, op1), 1));
+                    rhs = bv2int(int2bv(32, op0) & int2bv(32, op1), 1);
                     break;
                 case BinaryOperator::Or:
-                    addToSolver(res == bv2int(int2bv(32, op0) | int2bv(32, op1), 1));
+                    rhs = bv2int(int2bv(32, op0) | int2bv(32, op1), 1);
                     break;
                 case BinaryOperator::AShr:
-                    addToSolver(res == bv2int(ashr(int2bv(32, op0), int2bv(32, op1)), 1));
+                    rhs = bv2int(ashr(int2bv(32, op0), int2bv(32, op1)), 1);
                     break;
                 case BinaryOperator::Shl:
-                    addToSolver(res == bv2int(shl(int2bv(32, op0), int2bv(32, op1)), 1));
+                    rhs = bv2int(shl(int2bv(32, op0), int2bv(32, op1)), 1);
                     break;
                 default:
                     assert(false && "implement this part");
             }
+            if (constFolding() && op0.is_numeral() && op1.is_numeral())
+                rhs = rhs.simplify();
+            assign(binary->getResID(), rhs);
         }
         else if (const BranchStmt *br = SVFUtil::dyn_cast<BranchStmt>(stmt))
         {
             DBOP(std::cout << "\t skip handled when traversal Conditional IntraCFGEdge \n");
         }
         else if (const SelectStmt *select = SVFUtil::dyn_cast<SelectStmt>(stmt)) {
-            expr res = getZ3Expr(select->getResID());
             expr tval = getZ3Expr(select->getTrueValue()->getId());
             expr fval = getZ3Expr(select->getFalseValue()->getId());
             expr cond = getZ3Expr(select->getCondition()->getId());
-            addToSolver(res == ite(cond == getCtx().int_val(1), tval, fval));
+            if (constFolding() && cond.is_numeral())
+                assign(select->getResID(), cond.get_numeral_int64() == 1 ? tval : fval);
+            else
+                assign(select->getResID(), ite(cond == getCtx().int_val(1), tval, fval));
         }
         else if (const PhiStmt *phi = SVFUtil::dyn_cast<PhiStmt>(stmt)) {
-            expr res = getZ3Expr(phi->getResID());
-            bool opINodeFound = false;
-            for(u32_t i = 0; i < phi->getOpVarNum(); i++){
-                assert(srcNode && "we don't have a predecessor ICFGNode?");
-                if (srcNode->getFun()->postDominate(srcNode->getBB(),phi->getOpICFGNode(i)->getBB()))
-                {
-                    expr ope = getZ3Expr(phi->getOpVar(i)->getId());
-                    addToSolver(res == ope);
-                    opINodeFound = true;
+            assert(srcNode && "we don't have a predecessor ICFGNode?");
+            const std::vector<NodeID>& opnds = getPhiOperands(edge, phi);
+            assert(!opnds.empty() && "predecessor ICFGNode of this PhiStmt not found?");
+            for (NodeID opnd : opnds)
+                assign(phi->getResID(), getZ3Expr(opnd));
+        }
+    }
+
+    return true;
+}
+
+/// The operand of a PhiStmt taken along an incoming edge is the one whose ICFGNode is post-dominated by the
+/// edge's source. Computing it needs a dominator-tree query, so it is done once per (edge, phi) rather than per path.
+void SSE::buildPhiOperandTable() {
+    for (ICFG::iterator it = icfg->begin(); it != icfg->end(); ++it) {
+        const ICFGNode* node = it->second;
+        for (const SVFStmt* stmt : node->getSVFStmts()) {
+            if (const PhiStmt* phi = SVFUtil::dyn_cast<PhiStmt>(stmt)) {
+                for (const ICFGEdge* inEdge : node->getInEdges())
+                    if (SVFUtil::isa<IntraCFGEdge>(inEdge))
+                        getPhiOperands(inEdge, phi);
+            }
+        }
+    }
+}
+
+const std::vector<NodeID>& SSE::getPhiOperands(const ICFGEdge* edge, const PhiStmt* phi) {
+    ICFGEdgePhiPair key(edge, phi);
+    auto it = phiOperandMap.find(key);
+    if (it != phiOperandMap.end())
+        return it->second;
+
+    std::vector<NodeID>& opnds = phiOperandMap[key];
+    const ICFGNode* srcNode = edge->getSrcNode();
+    for (u32_t i = 0; i < phi->getOpVarNum(); i++) {
+        if (srcNode->getFun()->postDominate(srcNode->getBB(), phi->getOpICFGNode(i)->getBB()))
+            opnds.push_back(phi->getOpVar(i)->getId());
+    }
+    return opnds;
+}
+
+/// Collect the SVFG nodes backward reachable from the definitions of a set of SVFVars
+static void collectBackwardSlice(const Map<NodeID, const VFGNode*>& defNodes, const NodeBS& seeds,
+                                 Set<const VFGNode*>& slice) {
+    std::vector<const VFGNode*> worklist;
+    for (NodeID var : seeds) {
+        auto it = defNodes.find(var);
+        if (it != defNodes.end() && slice.insert(it->second).second)
+            worklist.push_back(it->second);
+    }
+    while (!worklist.empty()) {
+        const VFGNode* node = worklist.back();
+        worklist.pop_back();
+        for (const VFGEdge* edge : node->getInEdges()) {
+            if (slice.insert(edge->getSrcNode()).second)
+                worklist.push_back(edge->getSrcNode());
+        }
+    }
+}
+
+/// The slice of an assertion is everything its argument depends on, via direct (top-level) and indirect (memory)
+/// value-flows, together with the slices of the branch conditions sharing a node with it, until no other condition
+/// does. The other conditions only depend on values outside the slice. Operands read by the translator without a
+/// value-flow edge, i.e., variable GEP indices and SelectStmt operands, are in every slice.
+void SSE::computeSlice(const ICFGNode* sink) {
+    assert(svfg && "SVFG not built for sparse SSE?");
+    if (defNodes.empty()) {
+        for (SVFG::iterator it = svfg->begin(); it != svfg->end(); ++it) {
+            for (NodeID var : it->second->getDefSVFVars())
+                defNodes.emplace(var, it->second);
+        }
+
+        NodeBS seeds;
+        for (const SVFStmt* stmt : svfir->getSVFStmtSet(SVFStmt::Gep)) {
+            for (const auto& varType : SVFUtil::cast<GepStmt>(stmt)->getOffsetVarAndGepTypePairVec())
+                if (!SVFUtil::isa<ConstIntValVar>(varType.first))
+                    seeds.set(varType.first->getId());
+        }
+        for (const SVFStmt* stmt : svfir->getSVFStmtSet(SVFStmt::Select)) {
+            const SelectStmt* select = SVFUtil::cast<SelectStmt>(stmt);
+            for (const SVFVar* opnd : select->getOpndVars())
+                seeds.set(opnd->getId());
+            seeds.set(select->getCondition()->getId());
+        }
+        collectBackwardSlice(defNodes, seeds, baseSliceNodes);
+
+        NodeBS conds;
+        for (ICFG::iterator it = icfg->begin(); it != icfg->end(); ++it) {
+            for (const ICFGEdge* edge : it->second->getOutEdges()) {
+                if (const IntraCFGEdge* intra = SVFUtil::dyn_cast<IntraCFGEdge>(edge))
+                    if (intra->getCondition())
+                        conds.set(intra->getCondition()->getId());
+            }
+        }
+        for (NodeID cond : conds) {
+            NodeBS condSeeds;
+            condSeeds.set(cond);
+            condSlices.emplace_back(cond, Set<const VFGNode*>());
+            collectBackwardSlice(defNodes, condSeeds, condSlices.back().second);
+        }
+    }
+
+    Set<const VFGNode*> slice = baseSliceNodes;
+    NodeBS seeds;
+    seeds.set(SVFUtil::cast<CallICFGNode>(sink)->getActualParms().at(0)->getId());
+    collectBackwardSlice(defNodes, seeds, slice);
+
+    relevantConds.clear();
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& condSlice : condSlices) {
+            if (relevantConds.test(condSlice.first))
+                continue;
+            for (const VFGNode* node : condSlice.second) {
+                if (slice.find(node) != slice.end()) {
+                    relevantConds.set(condSlice.first);
+                    slice.insert(condSlice.second.begin(), condSlice.second.end());
+                    changed = true;
+                    break;
                 }
             }
-            assert(opINodeFound && "predecessor ICFGNode of this PhiStmt not found?");
         }
     }
 
-    return true;
+    sliceStmts.clear();
+    sliceVars.clear();
+    for (const VFGNode* node : slice) {
+        if (const StmtVFGNode* stmtNode = SVFUtil::dyn_cast<StmtVFGNode>(node))
+            sliceStmts.insert(stmtNode->getPAGEdge());
+        sliceVars |= node->getDefSVFVars();
+    }
+}
+
+bool SSE::inSlice(const SVFStmt* stmt) const {
+    // the base scopes are shared by the slices of all assertions
+    if (!svfg || encodingBase || fullTranslation)
+        return true;
+    // SelectStmts are seeded above rather than sliced; BranchStmts are handled on conditional edges instead
+    if (SVFUtil::isa<SelectStmt>(stmt))
+        return true;
+    if (SVFUtil::isa<BranchStmt>(stmt))
+        return false;
+    if (sliceStmts.find(stmt) != sliceStmts.end())
+        return true;
+    // a store is only needed if its own node is in the slice, not just its pointer
+    if (SVFUtil::isa<StoreStmt>(stmt))
+        return false;
+    if (const AssignStmt* assign = SVFUtil::dyn_cast<AssignStmt>(stmt))
+        return sliceVars.test(assign->getLHSVarID());
+    if (const MultiOpndStmt* multi = SVFUtil::dyn_cast<MultiOpndStmt>(stmt))
+        return sliceVars.test(multi->getResID());
+    return false;
+}
+
+bool SSE::isRelevantBranch(const IntraCFGEdge* edge) const {
+    if (!svfg || encodingBase || fullTranslation)
+        return true;
+    return relevantConds.test(edge->getCondition()->getId());
+}
+
+/// Two paths with the same key translate the same statements and the same branch conditions, so they have the same
+/// constraints on the slice.
+SSE::SliceKey SSE::getSliceKey(const std::vector<const ICFGEdge*>& path) const {
+    SliceKey key;
+    for (const ICFGEdge* edge : path) {
+        const ICFGNode* dst = edge->getDstNode();
+        const IntraCFGEdge* intra = SVFUtil::dyn_cast<IntraCFGEdge>(edge);
+        if (intra == nullptr || (intra->getCondition() && isRelevantBranch(intra))) {
+            key.push_back({dst, edge});
+            continue;
+        }
+        bool translated = false, selectsPhi = false;
+        for (const SVFStmt* stmt : dst->getSVFStmts()) {
+            if (inSlice(stmt)) {
+                translated = true;
+                selectsPhi |= SVFUtil::isa<PhiStmt>(stmt);
+            }
+        }
+        if (translated)
+            key.push_back({dst, selectsPhi ? edge : nullptr});
+    }
+    return key;
+}
+
+bool SSE::assertHolds(const ICFGNode* inode) {
+    const CallICFGNode* callnode = SVFUtil::cast<CallICFGNode>(inode);
+    z3::expr arg0 = getZ3Expr(callnode->getActualParms().at(0)->getId());
+    getSolver().push();
+    addToSolver(arg0 == getCtx().int_val(0));
+    bool holds = checkSolver() == z3::unsat;
+    getSolver().pop();
+    return holds;
 }
 
 /// Traverse each program path
@@ -392,13 +968,311 @@ bool SSE::translatePath(std::vector<const ICFGEdge*>& path) {
 
 /// Program entry
 void SSE::analyse() {
+    if (SSEOptions::BenchDFS()) {
+        benchmarkDFS();
+        return;
+    }
+    buildPhiOperandTable();
+    encodeBaseScopes();
+    const std::string& ckptFile = SSEOptions::Checkpoint();
+    if (!ckptFile.empty() && SSEOptions::Resume())
+        readCheckpoint(ckptFile);
+    const std::string& jsonFile = SSEOptions::Jsonl();
+    if (jsonFile == "-")
+        jsonOut = &std::cout;
+    else if (!jsonFile.empty()) {
+        // a resumed run continues the records of the interrupted one
+        jsonStream.open(jsonFile, SSEOptions::Resume() ? std::ios::app : std::ios::trunc);
+        if (jsonStream)
+            jsonOut = &jsonStream;
+        else
+            SVFUtil::errs() << "error opening " << jsonFile << "\n";
+    }
     for (const ICFGNode* src : identifySources()) {
         assert(SVFUtil::isa<GlobalICFGNode>(src) && "reachability should start with GlobalICFGNode!");
+        std::vector<const ICFGNode*> todo;
         for (const ICFGNode* sink : identifySinks()) {
-            const IntraCFGEdge startEdge(nullptr, const_cast<ICFGNode*>(src));
-            /// start traversing from the entry to each assertion and translate each path
-            reachability(&startEdge, sink);
-            resetSolver();
+            if (doneSinks.find(sink->getId()) == doneSinks.end())
+                todo.push_back(sink);
+        }
+        if (SSEOptions::Jobs() > 1 && todo.size() > 1) {
+            analyseSharded(src, todo);
+            continue;
+        }
+        for (const ICFGNode* sink : todo) {
+            // only the assertion in progress when the checkpoint was written has a frontier to resume from
+            resuming = (sink->getId() == curSinkId && !resumeFrontier.empty());
+            curSinkId = sink->getId();
+            analyseAssertion(src, sink);
+            resuming = false;
+            resumeFrontier.clear();
+            doneSinks.insert(sink->getId());
+            if (!ckptFile.empty())
+                writeCheckpoint(ckptFile);
+        }
+    }
+    // the run is complete, nothing left to resume
+    if (!ckptFile.empty())
+        std::remove(ckptFile.c_str());
+    if (SSEOptions::PrintStat())
+        printStat();
+}
+
+/// Only the enumeration is timed, the paths are counted instead of being translated
+void SSE::benchmarkDFS() {
+    const ICFGNode* src = *identifySources().begin();
+    const IntraCFGEdge startEdge(nullptr, const_cast<ICFGNode*>(src));
+    double elapsed[2] = {0, 0};
+    u64_t counts[2] = {0, 0};
+    u32_t mismatches = 0;
+    dfsCountOnly = true;
+    for (const ICFGNode* sink : identifySinks()) {
+        u64_t sinkCounts[2] = {0, 0};
+        for (u32_t recursive = 0; recursive < 2; recursive++) {
+            dfsPathCount = 0;
+            auto start = std::chrono::steady_clock::now();
+            if (recursive)
+                reachabilityRecursive(&startEdge, sink);
+            else
+                reachabilityIterative(&startEdge, sink);
+            elapsed[recursive] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            counts[recursive] += dfsPathCount;
+            sinkCounts[recursive] = dfsPathCount;
+        }
+        if (sinkCounts[0] != sinkCounts[1]) {
+            SVFUtil::errs() << "DFS MISMATCH at " << sink->toString() << ": " << sinkCounts[0] << " iterative vs "
+                            << sinkCounts[1] << " recursive paths\n";
+            mismatches++;
+        }
+    }
+    dfsCountOnly = false;
+
+    const char* names[2] = {"iterative", "recursive"};
+    SVFUtil::outs() << "\n*********DFS Benchmark*********\n";
+    for (u32_t i = 0; i < 2; i++) {
+        SVFUtil::outs() << names[i] << ": " << counts[i] << " paths in " << elapsed[i] << "s";
+        if (elapsed[i] > 0)
+            SVFUtil::outs() << " (" << (u64_t)(counts[i] / elapsed[i]) << " paths/s)";
+        SVFUtil::outs() << "\n";
+    }
+    SVFUtil::outs() << "*******************************\n";
+    SVFUtil::outs().flush();
+    // the timings mean nothing if the two traversals do not enumerate the same paths
+    if (mismatches != 0)
+        std::exit(1);
+}
+
+void SSE::tickCheckpoint() {
+    const std::string& ckptFile = SSEOptions::Checkpoint();
+    // a havoced run is not resumable path by path, its assertion restarts from scratch;
+    // the checkpoints of a sharded run are written by the coordinator
+    if (ckptFile.empty() || havocRun || shardFd >= 0)
+        return;
+    if (++pathsSinceCheckpoint < SSEOptions::CheckpointInterval())
+        return;
+    pathsSinceCheckpoint = 0;
+    writeCheckpoint(ckptFile);
+}
+
+/// A checkpoint holds the assertions done, the per-assertion results, and the DFS frontier of the assertion in
+/// progress as the index of each edge of the current path among the out-edges of its source. The traversal order is
+/// deterministic, so the frontier identifies the last translated path and everything explored before it.
+/// The tables derived from the IR (phi operands, GEP addresses, slices) are rebuilt on demand and not saved.
+void SSE::writeCheckpoint(const std::string& file) {
+    std::string tmpFile = file + ".tmp";
+    std::ofstream out(tmpFile, std::ios::out | std::ios::trunc);
+    if (!out) {
+        SVFUtil::errs() << "error opening checkpoint " << tmpFile << "\n";
+        return;
+    }
+    out << "sse-checkpoint 2\n";
+    out << "sink " << curSinkId << "\n";
+    out << "frontier " << frontier.size();
+    for (u32_t idx : frontier)
+        out << " " << idx;
+    out << "\ncallstack " << callstack.size();
+    for (const ICFGNode* cs : callstack)
+        out << " " << cs->getId();
+    out << "\ndone " << doneSinks.size();
+    for (NodeID id : doneSinks)
+        out << " " << id;
+    out << "\nresults " << sinkResults.size() << "\n";
+    for (const auto& it : sinkResults)
+        out << it.first << " " << it.second.numPaths << " " << it.second.numVerified << " " << it.second.numFailed << " "
+            << it.second.numCollapsed << " " << it.second.solverMs << "\n";
+    out.close();
+    std::rename(tmpFile.c_str(), file.c_str());
+}
+
+bool SSE::readCheckpoint(const std::string& file) {
+    std::ifstream in(file);
+    if (!in)
+        return false;
+    std::string tag;
+    u32_t version, num;
+    if (!(in >> tag >> version) || tag != "sse-checkpoint" || version != 2) {
+        SVFUtil::errs() << "ignoring malformed checkpoint " << file << "\n";
+        return false;
+    }
+    in >> tag >> curSinkId;
+    in >> tag >> num;
+    resumeFrontier.resize(num);
+    for (u32_t i = 0; i < num; i++)
+        in >> resumeFrontier[i];
+    // the call string is implied by the frontier, it is only kept for inspecting the file
+    in >> tag >> num;
+    for (u32_t i = 0; i < num; i++) {
+        NodeID cs;
+        in >> cs;
+    }
+    in >> tag >> num;
+    for (u32_t i = 0; i < num; i++) {
+        NodeID id;
+        in >> id;
+        doneSinks.insert(id);
+    }
+    in >> tag >> num;
+    for (u32_t i = 0; i < num; i++) {
+        NodeID id;
+        SinkResult result;
+        in >> id >> result.numPaths >> result.numVerified >> result.numFailed >> result.numCollapsed >> result.solverMs;
+        sinkResults[id] = result;
+    }
+    if (!in) {
+        SVFUtil::errs() << "ignoring truncated checkpoint " << file << "\n";
+        resumeFrontier.clear();
+        doneSinks.clear();
+        sinkResults.clear();
+        return false;
+    }
+    stat.numResumedSinks = doneSinks.size();
+    return true;
+}
+
+void SSE::analyseAssertion(const ICFGNode* src, const ICFGNode* sink) {
+    if (SSEOptions::Modular())
+        analyseModular(src, sink);
+    else
+        analyseSink(src, sink);
+    emitSinkResult(sink);
+}
+
+void SSE::analyseSink(const ICFGNode* src, const ICFGNode* sink) {
+    const IntraCFGEdge startEdge(nullptr, const_cast<ICFGNode*>(src));
+    if (svfg) {
+        computeSlice(sink);
+        slicedPaths.clear();
+    }
+    /// start traversing from the entry to each assertion and translate each path
+    z3Mgr->acquireSolver(Z3SSEMgr::EntryBase);
+    reachability(&startEdge, sink);
+    resetSolver();
+    z3Mgr->releaseSolver();
+}
+
+/// The havoced runs over-approximate the executions reaching their entry, so an assertion verified from the
+/// entries of a set of functions that cover all ways into the assertion's function is verified. Once the widening
+/// reaches a function without callers, only the whole program can tell whether a counterexample is real, and the
+/// assertion is checked from the program entry as in the default mode.
+void SSE::analyseModular(const ICFGNode* src, const ICFGNode* sink) {
+    havocReport.clear();
+    if (svfg)
+        computeSlice(sink);
+
+    std::vector<const FunObjVar*> worklist = {sink->getFun()};
+    Set<const FunObjVar*> visitedFuns = {sink->getFun()};
+    bool reachedProgramEntry = false;
+    while (!worklist.empty() && !reachedProgramEntry) {
+        const FunObjVar* fun = worklist.back();
+        worklist.pop_back();
+        const FunEntryICFGNode* entry = icfg->getFunEntryICFGNode(fun);
+
+        std::vector<const FunObjVar*> callers;
+        for (const ICFGEdge* edge : entry->getInEdges()) {
+            if (SVFUtil::isa<CallCFGEdge>(edge))
+                callers.push_back(edge->getSrcNode()->getFun());
+        }
+        if (callers.empty()) {
+            reachedProgramEntry = true;
+            break;
+        }
+        if (analyseHavoced(entry, sink))
+            continue;
+
+        stat.numWidenings++;
+        for (const FunObjVar* caller : callers) {
+            if (visitedFuns.insert(caller).second)
+                worklist.push_back(caller);
+        }
+    }
+
+    if (reachedProgramEntry)
+        analyseSink(src, sink);
+    else
+        writeOutput(havocReport);
+}
+
+bool SSE::analyseHavoced(const FunEntryICFGNode* entry, const ICFGNode* sink) {
+    const IntraCFGEdge startEdge(nullptr, const_cast<FunEntryICFGNode*>(entry));
+    size_t reportStart = havocReport.size();
+    havocRun = true;
+    havocCex = false;
+    slicedPaths.clear();
+    z3Mgr->acquireSolver(Z3SSEMgr::HavocBase);
+    reachability(&startEdge, sink);
+    resetSolver();
+    z3Mgr->releaseSolver();
+    havocRun = false;
+    // the verified paths of a run with a counterexample will be re-checked from the callers
+    if (havocCex)
+        havocReport.resize(reportStart);
+    return !havocCex;
+}
+
+/// Every path from the program entry starts with the statements of the GlobalICFGNode, which are not on the path
+/// itself since it begins with the edge out of that node; they are translated here once for all paths and assertions.
+/// A havoced run knows nothing about the values of the globals, so its base only holds their addresses.
+void SSE::encodeBaseScopes() {
+    encodingBase = true;
+    const IntraCFGEdge globalEdge(nullptr, const_cast<GlobalICFGNode*>(icfg->getGlobalICFGNode()));
+    z3Mgr->beginBase(Z3SSEMgr::EntryBase);
+    handleNonBranch(&globalEdge);
+    z3Mgr->endBase();
+    if (SSEOptions::Modular()) {
+        z3Mgr->beginBase(Z3SSEMgr::HavocBase);
+        translateGlobalAddresses();
+        z3Mgr->endBase();
+    }
+    encodingBase = false;
+    if (intervals)
+        intervals->clear();
+}
+
+void SSE::translateGlobalAddresses() {
+    for (const SVFStmt* stmt : icfg->getGlobalICFGNode()->getSVFStmts()) {
+        if (const AddrStmt* addr = SVFUtil::dyn_cast<AddrStmt>(stmt)) {
+            assign(addr->getLHSVarID(), getMemObjAddress(addr->getRHSVarID()));
+        }
+        else if (const GepStmt* gep = SVFUtil::dyn_cast<GepStmt>(stmt)) {
+            expr basePtr = getZ3Expr(gep->getRHSVarID());
+            s32_t offset = z3Mgr->getGepOffset(gep, callingCtx);
+            assign(gep->getLHSVarID(), z3Mgr->getGepObjAddress(basePtr, offset));
         }
     }
-}
\ No newline at end of file
+}
+
+void SSE::printStat() const {
+    SVFUtil::outs() << "\n*********SSE Statistics*********\n";
+    SVFUtil::outs() << "Assertions checked:            " << assert_checked << "\n";
+    SVFUtil::outs() << "Paths translated:              " << stat.numPaths << "\n";
+    SVFUtil::outs() << "Solver checks:                 " << stat.numSolverChecks << "\n";
+    SVFUtil::outs() << "Branches folded to constants:  " << stat.numConstBranches << "\n";
+    SVFUtil::outs() << "Branches decided by intervals: " << stat.numIntervalBranches << "\n";
+    SVFUtil::outs() << "Paths collapsed by slicing:    " << stat.numCollapsedPaths << "\n";
+    SVFUtil::outs() << "Branch checks deferred:        " << stat.numDeferredChecks << "\n";
+    SVFUtil::outs() << "Batched checks:                " << stat.numBatchedChecks << "\n";
+    SVFUtil::outs() << "Modular widenings:             " << stat.numWidenings << "\n";
+    SVFUtil::outs() << "Assertions restored:           " << stat.numResumedSinks << "\n";
+    SVFUtil::outs() << "Portfolio races:               " << stat.numPortfolioRaces << "\n";
+    SVFUtil::outs() << "********************************\n";
+}
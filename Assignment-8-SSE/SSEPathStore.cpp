@@ -0,0 +1,97 @@
+/**
+ * SSEPathStore.cpp
+ * @author kisslune
+ */
+
+#include "SSEPathStore.h"
+
+using namespace SVF;
+
+PathStore::PathStore(bool hash, const std::string& file) : hashMode(hash), spillFile(file) {
+    trie.push_back({0, 0, false});
+    if (hashMode && !spillFile.empty())
+        spill.open(spillFile, std::ios::out | std::ios::trunc);
+}
+
+uint32_t PathStore::getChild(uint32_t parent, uint32_t nodeId) {
+    uint64_t key = ((uint64_t)parent << 32) | nodeId;
+    auto it = children.find(key);
+    if (it != children.end())
+        return it->second;
+    uint32_t child = trie.size();
+    trie.push_back({parent, nodeId, false});
+    children.emplace(key, child);
+    return child;
+}
+
+/// Combine the ids with the splitmix64 finalizer; two paths colliding on 64 bits are not told apart
+uint64_t PathStore::hashPath(const std::vector<uint32_t>& nodes) {
+    uint64_t h = nodes.size();
+    for (uint32_t id : nodes) {
+        h += 0x9e3779b97f4a7c15ULL + id;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+bool PathStore::insert(const std::vector<uint32_t>& nodes) {
+    if (hashMode) {
+        if (!hashes.insert(hashPath(nodes)).second)
+            return false;
+        if (spill.is_open()) {
+            for (size_t i = 0; i < nodes.size(); i++)
+                spill << (i ? "->" : "") << nodes[i];
+            spill << "\n";
+        }
+        numPaths++;
+        return true;
+    }
+    uint32_t cur = 0;
+    for (uint32_t id : nodes)
+        cur = getChild(cur, id);
+    if (trie[cur].terminal)
+        return false;
+    trie[cur].terminal = true;
+    numPaths++;
+    return true;
+}
+
+std::set<std::string> PathStore::getPaths() {
+    std::set<std::string> paths;
+    if (hashMode) {
+        if (!spill.is_open())
+            return paths;
+        spill.flush();
+        std::ifstream in(spillFile);
+        std::string line;
+        while (std::getline(in, line))
+            paths.insert(line);
+        return paths;
+    }
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 1; i < trie.size(); i++) {
+        if (!trie[i].terminal)
+            continue;
+        ids.clear();
+        for (uint32_t cur = i; cur != 0; cur = trie[cur].parent)
+            ids.push_back(trie[cur].nodeId);
+        std::string str;
+        for (auto it = ids.rbegin(); it != ids.rend(); ++it)
+            str += (it == ids.rbegin() ? "" : "->") + std::to_string(*it);
+        paths.insert(str);
+    }
+    return paths;
+}
+
+void PathStore::clear() {
+    trie.resize(1);
+    children.clear();
+    hashes.clear();
+    numPaths = 0;
+    if (spill.is_open()) {
+        spill.close();
+        spill.open(spillFile, std::ios::out | std::ios::trunc);
+    }
+}
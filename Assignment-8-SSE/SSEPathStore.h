@@ -0,0 +1,66 @@
+/**
+ * SSEPathStore.h
+ * @author kisslune
+ */
+
+#ifndef ANSWERS_SSEPATHSTORE_H
+#define ANSWERS_SSEPATHSTORE_H
+
+#include <cstdint>
+#include <fstream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace SVF {
+
+/**
+ * Set of the ICFG paths enumerated by SSE, each given as the sequence of the ids of its nodes.
+ * By default the paths share their prefixes in a trie, so a path costs one trie node per edge not shared with a
+ * path stored before. In hash mode only a 64-bit hash of each path is kept, which bounds the memory at the price of
+ * decoding: the paths can only be listed back if they have been spilled to a file as they were inserted.
+ * The "a->b->c" strings of the paths are only built when they are asked for.
+ */
+class PathStore {
+public:
+    explicit PathStore(bool hashMode = false, const std::string& spillFile = "");
+
+    /// Add a path, return true if it was not in the store
+    bool insert(const std::vector<uint32_t>& nodes);
+
+    /// Number of distinct paths
+    inline size_t size() const {
+        return numPaths;
+    }
+
+    /// Decode the paths as "a->b->c" strings
+    std::set<std::string> getPaths();
+
+    void clear();
+
+private:
+    struct TrieNode {
+        uint32_t parent;    ///< index of the parent, the root is its own parent
+        uint32_t nodeId;    ///< id of the ICFG node
+        bool terminal;      ///< a path ends here
+    };
+
+    /// Index of the child of a trie node for an ICFG node, created if needed
+    uint32_t getChild(uint32_t parent, uint32_t nodeId);
+
+    static uint64_t hashPath(const std::vector<uint32_t>& nodes);
+
+    bool hashMode;
+    size_t numPaths = 0;
+    std::vector<TrieNode> trie;                             ///< trie nodes, the root at index 0
+    std::unordered_map<uint64_t, uint32_t> children;        ///< (parent, ICFG node id) -> child
+    std::unordered_set<uint64_t> hashes;                    ///< hashes of the paths in hash mode
+    std::string spillFile;                                  ///< file receiving the paths in hash mode, if any
+    std::ofstream spill;
+};
+
+} // namespace SVF
+
+#endif //ANSWERS_SSEPATHSTORE_H
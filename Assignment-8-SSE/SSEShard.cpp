@@ -0,0 +1,277 @@
+/**
+ * SSEShard.cpp
+ * @author kisslune
+ */
+
+#include "SSEHeader.h"
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace SVF;
+
+/// Header of a message from a worker; the worker's output follows it
+struct ShardFrame {
+    u32_t sinkIdx;          ///< index of the assertion in the list handed to the workers
+    u32_t failed;           ///< a counterexample has been found
+    u32_t last;             ///< the worker is done with the assertion
+    u32_t assertChecked;    ///< assertion checks since the previous frame
+    u32_t outLen;           ///< bytes of output following the frame
+    u32_t jsonLen;          ///< bytes of JSON lines following the output
+    SSEStat stat;           ///< statistics since the previous frame
+    SinkResult result;      ///< results since the previous frame
+};
+
+/// Marks the end of the work in a task message
+static const u32_t shardStop = ~0u;
+
+static bool writeAll(int fd, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+void SSE::sendShardResult(bool failed, bool last) {
+    ShardFrame frame;
+    frame.sinkIdx = shardSinkIdx;
+    frame.failed = failed;
+    frame.last = last;
+    frame.assertChecked = assert_checked;
+    frame.outLen = shardOutput.size();
+    frame.jsonLen = shardJson.size();
+    frame.stat = stat;
+    const SinkResult& result = sinkResults[curSinkId];
+    frame.result = result;
+    frame.result -= shardSent;
+    if (!writeAll(shardFd, &frame, sizeof(frame)) || !writeAll(shardFd, shardOutput.data(), shardOutput.size())
+        || !writeAll(shardFd, shardJson.data(), shardJson.size()))
+        _exit(1);  // the coordinator is gone
+    // everything is sent as a delta, so a worker that dies afterwards loses nothing already sent
+    assert_checked = 0;
+    stat = SSEStat();
+    shardSent = result;
+    shardOutput.clear();
+    shardJson.clear();
+}
+
+void SSE::runShardWorker(const ICFGNode* src, const std::vector<const ICFGNode*>& todo, int taskFd) {
+    assert_checked = 0;
+    stat = SSEStat();
+    sinkResults.clear();
+    u32_t idx;
+    while (readAll(taskFd, &idx, sizeof(idx)) && idx != shardStop) {
+        shardSinkIdx = idx;
+        curSinkId = todo[idx]->getId();
+        shardSent = SinkResult();
+        analyseAssertion(src, todo[idx]);
+        sendShardResult(false, true);
+    }
+}
+
+/// The assertions are handed out one at a time, so a worker that finishes early takes over the remaining ones
+/// instead of idling behind a fixed partition. The output of the workers is printed in the order of the assertions,
+/// as in a sequential run, and their statistics and results are merged into those of the coordinator.
+/// A worker that dies on a counterexample makes the coordinator fail on the same assertion once its output is
+/// printed. An assertion whose worker dies otherwise, e.g., killed for its memory, is handed out again, so what the
+/// worker sent for it is only merged once the assertion is done; the assertions left when all workers are gone are
+/// analysed by the coordinator itself.
+void SSE::analyseSharded(const ICFGNode* src, const std::vector<const ICFGNode*>& todo) {
+    struct Worker {
+        pid_t pid;
+        int taskFd;
+        int resultFd;
+        s32_t busy;     ///< assertion being analysed, -1 if idle
+    };
+    struct Outcome {
+        std::string output;
+        std::string json;
+        u32_t assertChecked = 0;
+        SSEStat stat;
+        SinkResult result;
+        bool failed = false;
+        bool done = false;
+    };
+
+    const u32_t numSinks = todo.size();
+    const u32_t numJobs = std::min<u32_t>(SSEOptions::Jobs(), numSinks);
+    const std::string& ckptFile = SSEOptions::Checkpoint();
+    std::vector<Outcome> outcomes(numSinks);
+    std::vector<Worker> workers;
+    u32_t next = 0;
+    std::vector<u32_t> retry;     ///< assertions of workers that died, handed out before the next ones
+
+    // anything buffered would otherwise be printed once more by each worker
+    SVFUtil::outs().flush();
+    std::cout.flush();
+    for (u32_t i = 0; i < numJobs; i++) {
+        int taskPipe[2], resultPipe[2];
+        if (pipe(taskPipe) != 0)
+            break;
+        if (pipe(resultPipe) != 0) {
+            close(taskPipe[0]);
+            close(taskPipe[1]);
+            break;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(taskPipe[1]);
+            close(resultPipe[0]);
+            for (const Worker& w : workers) {
+                close(w.taskFd);
+                close(w.resultFd);
+            }
+            shardFd = resultPipe[1];
+            runShardWorker(src, todo, taskPipe[0]);
+            // skip the destructors of the IR shared with the coordinator
+            _exit(0);
+        }
+        close(taskPipe[0]);
+        close(resultPipe[1]);
+        if (pid < 0) {
+            close(taskPipe[1]);
+            close(resultPipe[0]);
+            break;
+        }
+        workers.push_back({pid, taskPipe[1], resultPipe[0], -1});
+    }
+
+    auto dispatch = [&](Worker& w) {
+        u32_t task = !retry.empty() ? retry.back() : next < numSinks ? next : shardStop;
+        w.busy = -1;
+        if (!writeAll(w.taskFd, &task, sizeof(task)) || task == shardStop)
+            return;
+        if (!retry.empty())
+            retry.pop_back();
+        else
+            next++;
+        w.busy = task;
+    };
+    auto complete = [&](u32_t idx) {
+        Outcome& outcome = outcomes[idx];
+        if (jsonOut && !outcome.json.empty())
+            *jsonOut << outcome.json << std::flush;
+        assert_checked += outcome.assertChecked;
+        stat += outcome.stat;
+        sinkResults[todo[idx]->getId()] += outcome.result;
+        outcome.done = true;
+    };
+    for (Worker& w : workers)
+        dispatch(w);
+
+    u32_t printed = 0;
+    auto flushOutcomes = [&]() {
+        u32_t before = printed;
+        while (printed < numSinks && outcomes[printed].done) {
+            SVFUtil::outs() << outcomes[printed].output;
+            SVFUtil::outs().flush();
+            if (outcomes[printed].failed)
+                assert(false && "the assertion is unsatisfiable");
+            doneSinks.insert(todo[printed]->getId());
+            printed++;
+        }
+        if (!ckptFile.empty() && printed != before)
+            writeCheckpoint(ckptFile);
+    };
+
+    while (true) {
+        std::vector<struct pollfd> fds;
+        std::vector<Worker*> polled;
+        for (Worker& w : workers) {
+            if (w.busy >= 0) {
+                fds.push_back({w.resultFd, POLLIN, 0});
+                polled.push_back(&w);
+            }
+        }
+        if (fds.empty())
+            break;
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (u32_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents == 0)
+                continue;
+            Worker& w = *polled[i];
+            Outcome& outcome = outcomes[w.busy];
+            ShardFrame frame;
+            std::string output, json;
+            bool ok = readAll(w.resultFd, &frame, sizeof(frame));
+            if (ok) {
+                output.resize(frame.outLen);
+                json.resize(frame.jsonLen);
+                ok = readAll(w.resultFd, &output[0], frame.outLen) && readAll(w.resultFd, &json[0], frame.jsonLen);
+            }
+            if (!ok) {
+                SVFUtil::errs() << "SSE worker " << w.pid << " exited while analysing "
+                                << todo[w.busy]->toString() << "\n";
+                if (outcome.failed) {
+                    // it died on the counterexample it sent, which is kept
+                    complete(w.busy);
+                }
+                else {
+                    // anything else, e.g. a kill: the assertion starts over on the next worker to finish one,
+                    // or on the coordinator; idle workers have been stopped already
+                    outcome = Outcome();
+                    retry.push_back(w.busy);
+                }
+                w.busy = -1;
+                continue;
+            }
+            assert(frame.sinkIdx == (u32_t)w.busy && "frame of an assertion not handed to this worker");
+            outcome.output += output;
+            outcome.json += json;
+            outcome.failed |= frame.failed;
+            outcome.assertChecked += frame.assertChecked;
+            outcome.stat += frame.stat;
+            outcome.result += frame.result;
+            if (frame.last) {
+                complete(w.busy);
+                dispatch(w);
+            }
+        }
+        flushOutcomes();
+    }
+
+    for (Worker& w : workers) {
+        close(w.taskFd);
+        close(w.resultFd);
+        waitpid(w.pid, nullptr, 0);
+    }
+
+    // nobody left to take the remaining assertions, which are analysed in order so that the output is as well
+    for (; next < numSinks; next++)
+        retry.push_back(next);
+    std::sort(retry.begin(), retry.end());
+    for (u32_t idx : retry) {
+        flushOutcomes();
+        curSinkId = todo[idx]->getId();
+        analyseAssertion(src, todo[idx]);
+        outcomes[idx].done = true;
+    }
+    flushOutcomes();
+}
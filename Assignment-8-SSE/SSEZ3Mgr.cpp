@@ -4,10 +4,15 @@
  */
 
 #include "SSEZ3Mgr.h"
+#include <climits>
+#include <condition_variable>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <sstream>
+#include <thread>
 #include "SVF-LLVM/LLVMUtil.h"
 
 using namespace SVF;
@@ -54,6 +59,9 @@ s32_t Z3Mgr::z3Expr2NumValue(z3::expr e)
 /// and evaluates the given complex expression e within this model, returning the evaluated result
 z3::expr Z3Mgr::getEvalExpr(z3::expr e)
 {
+    // a numeral evaluates to itself, no need to query the solver
+    if (e.is_numeral())
+        return e;
     z3::check_result res = solver.check();
     assert(res != z3::unsat && "unsatisfied constraints! Check your contradictory constraints added to the solver");
     z3::model m = solver.get_model();
@@ -92,7 +100,127 @@ void Z3Mgr::printZ3Exprs()
 
 Z3SSEMgr::Z3SSEMgr(SVFIR* ir)
         : Z3Mgr(ir->getPAGNodeNum() * 10)
-        , svfir(ir) {
+        , svfir(ir)
+        , constFolding(false)
+        , trackInputs(false)
+        , portfolioThreshold(0)
+        , raceModel(ctx)
+        , raceModelValid(false)
+        , raced(false)
+        , solverPooling(false)
+        , curBase(EntryBase) {
+}
+
+/// Configurations of the portfolio: the default solver, the logic-specific solver of the SSE constraints,
+/// a preprocessing pipeline before the SMT core, and the nonlinear integer tactics for Mul/SDiv
+static const u32_t portfolioSize = 4;
+
+static z3::solver makePortfolioSolver(z3::context& c, u32_t config) {
+    switch (config) {
+    case 0:
+        return z3::solver(c);
+    case 1:
+        return z3::solver(c, "QF_AUFLIA");
+    case 2:
+        return (z3::tactic(c, "simplify") & z3::tactic(c, "propagate-values") & z3::tactic(c, "solve-eqs")
+                & z3::tactic(c, "smt")).mk_solver();
+    default:
+        return (z3::tactic(c, "simplify") & z3::tactic(c, "qfnia")).mk_solver();
+    }
+}
+
+/// Race the configurations of the portfolio on the assertions of a solver, each on its own thread and context.
+/// The first conclusive answer wins and the other contexts are interrupted. If the winner answers sat, its model is
+/// translated into the context of the solver.
+static z3::check_result racePortfolio(z3::solver& solver, z3::model& model) {
+    z3::context& ctx = solver.ctx();
+    z3::expr_vector assertions = solver.assertions();
+    std::vector<std::unique_ptr<z3::context>> ctxs;
+    std::vector<std::unique_ptr<z3::solver>> solvers;
+    // contexts are not thread-safe: everything is translated here, before the threads start
+    for (u32_t i = 0; i < portfolioSize; i++) {
+        ctxs.emplace_back(new z3::context());
+        z3::context& c = *ctxs.back();
+        z3::solver* s = nullptr;
+        try {
+            s = new z3::solver(makePortfolioSolver(c, i));
+            for (unsigned j = 0; j < assertions.size(); j++)
+                s->add(z3::expr(c, Z3_translate(ctx, assertions[j], c)));
+        }
+        catch (const z3::exception&) {
+            delete s;
+            s = nullptr;
+        }
+        solvers.emplace_back(s);
+    }
+
+    std::mutex mtx;
+    std::condition_variable done;
+    s32_t winner = -1;
+    u32_t finished = 0;
+    z3::check_result result = z3::unknown;
+    std::vector<std::thread> threads;
+    for (u32_t i = 0; i < portfolioSize; i++) {
+        threads.emplace_back([&, i]() {
+            z3::check_result res = z3::unknown;
+            if (solvers[i]) {
+                try {
+                    res = solvers[i]->check();
+                }
+                catch (const z3::exception&) {
+                    res = z3::unknown;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            finished++;
+            if (res != z3::unknown && winner < 0) {
+                winner = i;
+                result = res;
+            }
+            done.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        done.wait(lock, [&]() { return winner >= 0 || finished == portfolioSize; });
+    }
+    for (u32_t i = 0; i < portfolioSize; i++) {
+        if ((s32_t)i != winner)
+            ctxs[i]->interrupt();
+    }
+    for (std::thread& t : threads)
+        t.join();
+
+    if (result == z3::sat) {
+        z3::model m = solvers[winner]->get_model();
+        model = z3::model(ctx, Z3_model_translate(*ctxs[winner], m, ctx));
+    }
+    // the solvers have to go before their contexts
+    solvers.clear();
+    return result;
+}
+
+z3::check_result Z3SSEMgr::check() {
+    raced = false;
+    raceModelValid = false;
+    if (portfolioThreshold == 0)
+        return solver.check();
+    solver.set("timeout", portfolioThreshold);
+    z3::check_result res = solver.check();
+    // no timeout for the other queries, e.g., those of getEvalExpr
+    solver.set("timeout", UINT_MAX);
+    if (res != z3::unknown)
+        return res;
+    raced = true;
+    res = racePortfolio(solver, raceModel);
+    raceModelValid = (res == z3::sat);
+    return res;
+}
+
+z3::model Z3SSEMgr::getModel() {
+    if (raceModelValid)
+        return raceModel;
+    return solver.get_model();
 }
 
 
@@ -118,7 +246,8 @@ z3::expr Z3SSEMgr::createExprForObjVar(const ObjVar* objVar) {
             e = ctx.int_val(getVirtualMemAddress(objVar->getId()));
         }
         else if (obj->isConstantArray() || obj->isConstantStruct()) {
-            assert(false && "implement this part");
+            // a constant aggregate is a location, its elements are stored by the global initialisers
+            e = ctx.int_val(getVirtualMemAddress(objVar->getId()));
         }
         else {
             std::cerr << obj->toString() << "\n";
@@ -146,24 +275,161 @@ std::string Z3SSEMgr::callingCtxToStr(const CallStack& callingCtx) {
 z3::expr Z3SSEMgr::getZ3Expr(SVF::u32_t idx, const CallStack& callingCtx) {
     u32_t varId = getInternalID(idx);
     assert(varId == idx && "SVFVar idx overflow > 0x7f000000?");
-    std::string str;
-    std::stringstream rawstr(str);
     const SVFVar *svfVar = svfir->getGNode(varId);
     if (const ObjVar* objVar = SVFUtil::dyn_cast<ObjVar>(svfVar)) {
         return createExprForObjVar(objVar);
+    }
+    if (constFolding) {
+        // Integer constants are known without going through their AddrStmt
+        if (const ConstIntValVar* constInt = SVFUtil::dyn_cast<ConstIntValVar>(svfVar))
+            return ctx.int_val((s32_t)constInt->getSExtValue());
+        z3::expr sym = getSymZ3Expr(idx, callingCtx);
+        auto it = constValMap.find(sym.decl().name().str());
+        if (it != constValMap.end())
+            return it->second;
+        return sym;
+    }
+    return getSymZ3Expr(idx, callingCtx);
+}
+
+z3::expr Z3SSEMgr::getSymZ3Expr(SVF::u32_t idx, const CallStack& callingCtx) {
+    u32_t varId = getInternalID(idx);
+    std::string str;
+    std::stringstream rawstr(str);
+    const SVFVar *svfVar = svfir->getGNode(varId);
+    // Check if svfVar does not have a value or it has a constant value
+    if (!SVFUtil::isa<ConstDataValVar, ConstDataObjVar>(svfVar)) {
+        // If there is a non-constant value, add callingCtx to z3 expr
+        rawstr << callingCtxToStr(callingCtx);
     } else {
+        // If there's no value or it's a constant, we do not add the callingCtx to z3 expr
+    }
+    rawstr << "ValVar" << varId;
+    std::string name = rawstr.str();
+    return ctx.int_const(name.c_str());
+}
 
-        // Check if svfVar does not have a value or it has a constant value
-        if (!SVFUtil::isa<ConstDataValVar, ConstDataObjVar>(svfVar)) {
-            // If there is a non-constant value, add callingCtx to z3 expr
-            rawstr << callingCtxToStr(callingCtx);
-        } else {
-            // If there's no value or it's a constant, we do not add the callingCtx to z3 expr
+/// A ValVar may be assigned more than once on a path (e.g., a loop header reached from both the preheader
+/// and the latch). Each assignment is a constraint of its own, so a folded value is handed over to the
+/// solver as soon as the ValVar gets a different or a symbolic value; from then on it stays symbolic.
+z3::expr Z3SSEMgr::assignZ3Expr(u32_t lhs, const CallStack& callingCtx, z3::expr rhs) {
+    z3::expr lhsExpr = getSymZ3Expr(lhs, callingCtx);
+    if (!constFolding && !trackInputs)
+        return lhsExpr == rhs;
+
+    std::string name = lhsExpr.decl().name().str();
+    if (trackInputs && dependsOnInput(rhs))
+        inputValSet.insert(name);
+    if (!constFolding) {
+        symValSet.insert(name);
+        return lhsExpr == rhs;
+    }
+
+    auto it = constValMap.find(name);
+    if (rhs.is_numeral() && symValSet.find(name) == symValSet.end()) {
+        if (it == constValMap.end()) {
+            constValMap.emplace(name, rhs);
+            return ctx.bool_val(true);
         }
-        rawstr << "ValVar" << varId;
-        std::string name = rawstr.str();
-        return ctx.int_const(name.c_str());
+        if (z3::eq(it->second, rhs))
+            return ctx.bool_val(true);
+    }
+
+    z3::expr cons = (lhsExpr == rhs);
+    if (it != constValMap.end()) {
+        cons = (lhsExpr == it->second) && cons;
+        constValMap.erase(it);
+    }
+    symValSet.insert(name);
+    return cons;
+}
+
+/// The inputs of a path are the ValVars it reads without defining them (e.g., parameters of a havoced run or
+/// results of external calls) and the initial memory. Defined ValVars depend on an input if their value does.
+bool Z3SSEMgr::dependsOnInput(const z3::expr& e) const {
+    if (e.is_numeral())
+        return false;
+    if (!e.is_app())
+        return true;
+    if (e.num_args() == 0) {
+        std::string name = e.decl().name().str();
+        if (inputValSet.find(name) != inputValSet.end())
+            return true;
+        return constValMap.find(name) == constValMap.end() && symValSet.find(name) == symValSet.end();
+    }
+    for (unsigned i = 0; i < e.num_args(); i++) {
+        if (dependsOnInput(e.arg(i)))
+            return true;
+    }
+    return false;
+}
+
+void Z3SSEMgr::acquireSolver(SolverBase base) {
+    curBase = base;
+    std::vector<z3::solver>& pool = solverPool[base];
+    if (solverPooling && !pool.empty()) {
+        solver = pool.back();
+        pool.pop_back();
+        solver.push();
+        return;
+    }
+    solver = z3::solver(ctx);
+    for (const z3::expr& fact : baseFacts[base])
+        solver.add(fact);
+    if (solverPooling)
+        solver.push();
+}
+
+void Z3SSEMgr::releaseSolver() {
+    if (!solverPooling)
+        return;
+    unsigned scopes = Z3_solver_get_num_scopes(ctx, solver);
+    if (scopes > 0)
+        solver.pop(scopes);
+    solverPool[curBase].push_back(solver);
+}
+
+void Z3SSEMgr::resetSolver() {
+    if (solverPooling) {
+        unsigned scopes = Z3_solver_get_num_scopes(ctx, solver);
+        if (scopes > 0)
+            solver.pop(scopes);
+        solver.push();
+        return;
     }
+    solver.reset();
+    for (const z3::expr& fact : baseFacts[curBase])
+        solver.add(fact);
+}
+
+void Z3SSEMgr::beginBase(SolverBase base) {
+    curBase = base;
+    solver = z3::solver(ctx);
+    constValMap.clear();
+    symValSet.clear();
+    inputValSet.clear();
+    resetZ3ExprMap();
+}
+
+void Z3SSEMgr::endBase() {
+    z3::expr_vector facts = solver.assertions();
+    baseFacts[curBase].clear();
+    for (unsigned i = 0; i < facts.size(); i++)
+        baseFacts[curBase].push_back(facts[i]);
+    baseConstVals[curBase] = constValMap;
+    baseSymVals[curBase] = symValSet;
+    baseInputVals[curBase] = inputValSet;
+    baseMemory[curBase] = {getMemory()};
+    solverPool[curBase].clear();
+}
+
+void Z3SSEMgr::resetPathState() {
+    constValMap = baseConstVals[curBase];
+    symValSet = baseSymVals[curBase];
+    inputValSet = baseInputVals[curBase];
+    resetZ3ExprMap();
+    if (!baseMemory[curBase].empty())
+        setMemory(baseMemory[curBase].front());
 }
 
 /// Return the address expr of a ObjVar
@@ -176,19 +442,29 @@ z3::expr Z3SSEMgr::getMemObjAddress(u32_t idx) {
 z3::expr Z3SSEMgr::getGepObjAddress(z3::expr pointer, u32_t offset) {
     NodeID obj = getInternalID(z3Expr2NumValue(pointer));
     assert(SVFUtil::isa<ObjVar>(svfir->getGNode(obj)) && "Fail to get the base object address!");
+    /// reuse the field address if this (object, offset) pair has been visited before
+    std::pair<NodeID, u32_t> key(obj, offset);
+    auto it = gepObjAddrMap.find(key);
+    if (it != gepObjAddrMap.end())
+        return it->second;
+
     NodeID gepObj = svfir->getGepObjVar(obj, offset);
-    /// TODO: check whether this node has been created before or not to save creation time
-    if (obj == gepObj)
-        return createExprForObjVar(SVFUtil::cast<ObjVar>(svfir->getGNode(obj)));
-    else
-        return createExprForObjVar(SVFUtil::cast<GepObjVar>(svfir->getGNode(gepObj)));
+    z3::expr addr = (obj == gepObj) ? createExprForObjVar(SVFUtil::cast<ObjVar>(svfir->getGNode(obj)))
+                                    : createExprForObjVar(SVFUtil::cast<GepObjVar>(svfir->getGNode(gepObj)));
+    gepObjAddrMap.emplace(key, addr);
+    return addr;
 }
 
 s32_t Z3SSEMgr::getGepOffset(const GepStmt* gep, const CallStack& callingCtx) {
     if (gep->getOffsetVarAndGepTypePairVec().empty())
         return gep->getConstantStructFldIdx();
 
+    auto it = constGepOffsetMap.find(gep);
+    if (it != constGepOffsetMap.end())
+        return it->second;
+
     s32_t totalOffset = 0;
+    bool isConstGep = true;
     for (int i = gep->getOffsetVarAndGepTypePairVec().size() - 1; i >= 0; i--) {
         const SVFVar* var = gep->getOffsetVarAndGepTypePairVec()[i].first;
         const SVFType* type = gep->getOffsetVarAndGepTypePairVec()[i].second;
@@ -197,6 +473,7 @@ s32_t Z3SSEMgr::getGepOffset(const GepStmt* gep, const CallStack& callingCtx) {
             offset = constInt->getSExtValue();
         } else {
             offset = z3Expr2NumValue(getZ3Expr(var->getId(), callingCtx));
+            isConstGep = false;
         }
 
         if (type == nullptr) {
@@ -210,6 +487,9 @@ s32_t Z3SSEMgr::getGepOffset(const GepStmt* gep, const CallStack& callingCtx) {
         else
             totalOffset += PAG::getPAG()->getFlattenedElemIdx(type, offset);
     }
+    /// the offset of a constant-index GepStmt does not depend on the path, compute it only once
+    if (isConstGep)
+        constGepOffsetMap[gep] = totalOffset;
     return totalOffset;
 }
 
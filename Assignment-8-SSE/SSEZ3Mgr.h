@@ -55,6 +55,16 @@ public:
 
     /// Store and Select for Loc2ValMap, i.e., store and load
     z3::expr storeValue(const z3::expr loc, const z3::expr value);
+
+    /// Return/replace the whole memory, i.e., Loc2ValMap
+    inline z3::expr getMemory() const
+    {
+        return varID2ExprMap[lastSlot];
+    }
+    inline void setMemory(const z3::expr& mem)
+    {
+        varID2ExprMap.set(lastSlot, mem);
+    }
     z3::expr loadValue(const z3::expr loc);
 
     /// The physical address starts with 0x7f...... + idx
@@ -168,14 +178,84 @@ class GepStmt;
 class Z3SSEMgr : public Z3Mgr {
     typedef std::vector<const ICFGNode*> CallStack;
 public:
+    /// Base scopes a pooled solver can be handed out with: paths from the program entry, or havoced runs
+    enum SolverBase { EntryBase, HavocBase, NumSolverBases };
+
     /// Constructor
     Z3SSEMgr(SVFIR* ir);
 
 
     std::string callingCtxToStr(const CallStack& callingCtx);
 
+    /// Return the Z3 expression of an SVFVar, or its folded constant value if it has one
     z3::expr getZ3Expr(u32_t idx, const CallStack& callingCtx);
 
+    /// Return the symbolic Z3 constant of a ValVar under a calling context, ignoring any folded value
+    z3::expr getSymZ3Expr(u32_t idx, const CallStack& callingCtx);
+
+    /// Return the constraint encoding "lhs = rhs" for a ValVar lhs (true if none is needed).
+    /// With constant folding, a numeral rhs is kept as a concrete binding of lhs instead of a solver constraint
+    z3::expr assignZ3Expr(u32_t lhs, const CallStack& callingCtx, z3::expr rhs);
+
+    /// Enable or disable constant folding in the translator
+    inline void setConstFolding(bool enable) {
+        constFolding = enable;
+    }
+
+    inline bool isConstFolding() const {
+        return constFolding;
+    }
+
+    /// Enable or disable tracking which ValVars depend on symbolic inputs of the path
+    inline void setTrackInputs(bool enable) {
+        trackInputs = enable;
+    }
+
+    /// Return true if an expression depends on a symbolic input of the current path
+    bool dependsOnInput(const z3::expr& e) const;
+
+    /// Race a portfolio of solver configurations on the checks taking more than thresholdMs (0 to disable)
+    inline void setPortfolioThreshold(u32_t thresholdMs) {
+        portfolioThreshold = thresholdMs;
+    }
+
+    /// Check the constraints of the solver, racing the portfolio if the default configuration is too slow
+    z3::check_result check();
+
+    /// Return the model of the last check, which may come from the portfolio
+    z3::model getModel();
+
+    /// Return true if the last check has been decided by racing the portfolio
+    inline bool lastCheckRaced() const {
+        return raced;
+    }
+
+    /// Reuse solvers across paths and assertions instead of resetting them
+    inline void setSolverPooling(bool enable) {
+        solverPooling = enable;
+    }
+
+    /// Make the solver a pooled one holding the facts of a base scope, with an empty scope pushed for the path
+    void acquireSolver(SolverBase base);
+
+    /// Give the solver back to the pool of its base scope
+    void releaseSolver();
+
+    /// Drop the constraints of the current path. A pooled solver is popped back to its base scope, which keeps
+    /// the base facts and what Z3 has learned about them; otherwise the solver is reset and the base facts re-added
+    void resetSolver();
+
+    /// Start encoding the statements shared by every path from a base scope, with an empty solver and path state
+    void beginBase(SolverBase base);
+
+    /// Make what has been encoded since beginBase the base scope: the solver constraints become the base facts,
+    /// and the folded values and the memory become the state every path starts from.
+    /// The idle solvers of the base are dropped, so the base is meant to be encoded before the analysis starts
+    void endBase();
+
+    /// Drop everything learned along the current path (folded values and memory) and go back to the base state
+    void resetPathState();
+
     /// Initialize the expr value for each objects (address-taken variables and constants)
     z3::expr createExprForObjVar(const ObjVar* obj);
 
@@ -193,6 +273,30 @@ public:
 
 private:
     SVFIR* svfir;
+    /// (base object, flattened offset) -> field address, filled lazily by getGepObjAddress
+    Map<std::pair<NodeID, u32_t>, z3::expr> gepObjAddrMap;
+    /// Flattened offsets of the GepStmts whose indices are all constants
+    Map<const GepStmt*, s32_t> constGepOffsetMap;
+    /// Z3 constant name -> folded value of the ValVars assigned a constant on the current path
+    Map<std::string, z3::expr> constValMap;
+    /// Z3 constant names of the ValVars assigned a symbolic value on the current path
+    Set<std::string> symValSet;
+    /// Z3 constant names of the ValVars whose value depends on a symbolic input on the current path
+    Set<std::string> inputValSet;
+    bool constFolding;
+    bool trackInputs;
+    u32_t portfolioThreshold;   ///< latency in ms above which a check is raced, 0 if disabled
+    z3::model raceModel;        ///< model of the last check won by the portfolio
+    bool raceModelValid;
+    bool raced;
+    bool solverPooling;
+    SolverBase curBase;                                     ///< base scope of the solver
+    std::vector<z3::expr> baseFacts[NumSolverBases];        ///< facts of each base scope
+    std::vector<z3::solver> solverPool[NumSolverBases];     ///< idle solvers of each base scope, at the base scope
+    Map<std::string, z3::expr> baseConstVals[NumSolverBases];   ///< folded values at the end of each base
+    Set<std::string> baseSymVals[NumSolverBases];
+    Set<std::string> baseInputVals[NumSolverBases];
+    std::vector<z3::expr> baseMemory[NumSolverBases];       ///< memory image at the end of each base, if encoded
 };
 
 } // namespace SVF
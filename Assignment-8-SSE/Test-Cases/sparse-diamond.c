@@ -0,0 +1,15 @@
+#include "stdbool.h"
+extern void svf_assert(bool);
+
+// With -sse-sparse, the branch on z is outside the slice of the assertion, so the two paths translate the same
+// statements: the first one is verified and the second one is collapsed ("Paths collapsed by slicing: 1" with
+// -sse-stat, and the verdict "collapsed" for path 1 with -sse-jsonl).
+void main(int x, int z) {
+  int y = x + 1;
+  int w;
+  if (z > 0)
+    w = 1;
+  else
+    w = 2;
+  svf_assert(y > x);
+}